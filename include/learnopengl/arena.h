@@ -0,0 +1,149 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Region allocator for the data of one import: small allocations are carved out of shared blocks and never freed one
+// by one, the whole arena is released at once when the import is done with. Large ones (vertex and index lists) get
+// a mapping of their own that goes back as soon as they are freed, so a list that is rebuilt or shrunk does not leave
+// its old storage behind. Everything is mapped straight from the system, releasing gives the memory back instead of
+// leaving it in the heap. Not thread safe, every import has its own.
+class Arena
+{
+public:
+    // size of the shared blocks, allocations above a quarter of it are mapped on their own
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    Arena() = default;
+    ~Arena()
+    {
+        Release();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // alignment at most the page size
+    void *Allocate(size_t size, size_t alignment)
+    {
+        if (size > BLOCK_SIZE / 4)
+        {
+            unsigned char *mapping = mapBlock(size);
+            large.push_back(std::make_pair(mapping, size));
+            return mapping;
+        }
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (blocks.empty() || offset + size > BLOCK_SIZE)
+        {
+            blocks.push_back(mapBlock(BLOCK_SIZE));
+            offset = 0;
+        }
+        used = offset + size;
+        return blocks.back() + offset;
+    }
+
+    // gives back a large allocation, small ones stay until Release
+    void Free(void *pointer)
+    {
+        for (size_t i = 0; i < large.size(); i++)
+        {
+            if (large[i].first != pointer)
+                continue;
+            unmapBlock(large[i].first, large[i].second);
+            large[i] = large.back();
+            large.pop_back();
+            return;
+        }
+    }
+
+    // frees every block, everything allocated from the arena is gone
+    void Release()
+    {
+        for (unsigned char *block : blocks)
+            unmapBlock(block, BLOCK_SIZE);
+        for (const std::pair<unsigned char *, size_t> &mapping : large)
+            unmapBlock(mapping.first, mapping.second);
+        blocks.clear();
+        blocks.shrink_to_fit();
+        large.clear();
+        large.shrink_to_fit();
+        used = 0;
+    }
+
+    // bytes mapped now, and the most that were mapped at once since construction
+    size_t BytesReserved() const { return reserved; }
+    size_t PeakBytesReserved() const { return peak; }
+
+private:
+    std::vector<unsigned char *> blocks;
+    std::vector<std::pair<unsigned char *, size_t>> large;
+    size_t used = 0; // of the last block
+    size_t reserved = 0, peak = 0;
+
+    unsigned char *mapBlock(size_t size)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED)
+            throw std::bad_alloc();
+        reserved += size;
+        peak = std::max(peak, reserved);
+        return (unsigned char *)mapping;
+    }
+
+    void unmapBlock(unsigned char *block, size_t size)
+    {
+        munmap(block, size);
+        reserved -= size;
+    }
+};
+
+// standard allocator on top of an Arena, for containers of import data. Without an arena it falls back to the heap, so
+// such containers still work as ordinary temporaries.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    // moved and swapped containers keep their arena, so moving them never copies
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() : arena(nullptr) {}
+    explicit ArenaAllocator(Arena *arena) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t count)
+    {
+        if (arena)
+            return (T *)arena->Allocate(count * sizeof(T), alignof(T));
+        return (T *)::operator new(count * sizeof(T));
+    }
+
+    void deallocate(T *pointer, size_t)
+    {
+        if (arena)
+            arena->Free(pointer);
+        else
+            ::operator delete(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+    Arena *arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef ASSET_RELOADER_H
+#define ASSET_RELOADER_H
+
+#include <learnopengl/asset_watcher.h>
+#include <learnopengl/model.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Hot reload of the assets under a directory while the program runs. A changed model file (or one of the material
+// libraries next to it) is imported again into a staging model on the thread pool, like ModelLoader does, and swapped
+// into the watched model between two frames once it is uploaded; a model that fails to import keeps what it had. A
+// changed texture file is reloaded through the TextureRegistry, in place or, when it shared its texture with copies of
+// it, into a texture of its own for the models using it. Everything else that is loaded stays as it is.
+class AssetReloader
+{
+public:
+    AssetReloader(ThreadPool &pool, TextureLoader &textureLoader, const std::string &root)
+        : pool(pool), textureLoader(textureLoader), watcher(root), inFlight(0)
+    {
+        if (!watcher.IsOpen())
+            std::cout << "WARNING::ASSET_RELOADER:: cannot watch " << root << ", hot reload is off" << std::endl;
+    }
+
+    ~AssetReloader()
+    {
+        // imports still running write into our queue, wait for them before going away
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return inFlight == 0; });
+    }
+
+    AssetReloader(const AssetReloader &) = delete;
+    AssetReloader &operator=(const AssetReloader &) = delete;
+
+    // reloads model whenever its file changes. The model must be loaded already and outlive the reloader.
+    void Watch(Model &model)
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(model.path.c_str(), resolved))
+            return;
+        watched.emplace_back(new Watched(model));
+        Watched &entry = *watched.back();
+        entry.path = resolved;
+        entry.directory = entry.path.substr(0, entry.path.find_last_of('/'));
+    }
+
+    // picks up the files changed since the last call, starts their imports and swaps in the models whose import is
+    // done. Call once per frame on the GL thread, before anything is drawn.
+    void Update()
+    {
+        for (const std::string &path : watcher.Poll())
+        {
+            bool isModel = false;
+            for (const std::unique_ptr<Watched> &entry : watched)
+            {
+                if (path == entry->path || (endsWith(path, ".mtl") && path.substr(0, path.find_last_of('/')) == entry->directory))
+                {
+                    reimport(*entry);
+                    isModel = true;
+                }
+            }
+            std::vector<TextureSplit> splits;
+            if (!isModel && TextureRegistry::Instance().Reload(path, splits))
+                std::cout << "ASSET_RELOADER:: reloading " << path << std::endl;
+            // a texture shared with copies of the file stays theirs, the models using this file move to its own
+            for (const TextureSplit &split : splits)
+                for (const std::unique_ptr<Watched> &entry : watched)
+                    entry->model.RepointTextures(split);
+        }
+
+        for (;;)
+        {
+            Watched *entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (completed.empty())
+                    break;
+                entry = completed.front();
+                completed.pop_front();
+            }
+            std::unique_ptr<Model> staging = std::move(entry->staging);
+            entry->importing = false;
+            staging->Upload(&textureLoader);
+            if (staging->meshes.empty())
+            {
+                std::cout << "WARNING::ASSET_RELOADER:: " << entry->path << " did not import, keeping the loaded model" << std::endl;
+            }
+            else
+            {
+                entry->model.Replace(*staging);
+                std::cout << "ASSET_RELOADER:: reloaded " << entry->path << std::endl;
+            }
+            // the staging model holds the old meshes and textures now, or the failed import. Its geometry ranges go
+            // back to the heap as holes the next uploads fill; packing them would move every other model's ranges,
+            // which is left to the Defragment button of the ImGui window.
+            staging->ReleaseTextures();
+            staging.reset();
+            if (entry->dirty)
+                reimport(*entry);
+        }
+    }
+
+private:
+    struct Watched {
+        explicit Watched(Model &model) : model(model) {}
+        Model &model;
+        std::string path;      // canonical
+        std::string directory; // of path
+        std::unique_ptr<Model> staging;
+        bool importing = false;
+        bool dirty = false; // changed again while importing
+    };
+
+    ThreadPool &pool;
+    TextureLoader &textureLoader;
+    AssetWatcher watcher;
+    std::vector<std::unique_ptr<Watched>> watched;
+    std::deque<Watched *> completed;
+    unsigned int inFlight;
+    std::mutex mutex;
+    std::condition_variable idle;
+
+    void reimport(Watched &entry)
+    {
+        if (entry.importing)
+        {
+            entry.dirty = true;
+            return;
+        }
+        entry.importing = true;
+        entry.dirty = false;
+        // loaded the way the watched model was
+        entry.staging.reset(new Model());
+        entry.staging->gammaCorrection = entry.model.gammaCorrection;
+        entry.staging->compactVertices = entry.model.compactVertices;
+        entry.staging->keepCpuData = entry.model.keepCpuData;
+        entry.staging->staticBatch = entry.model.staticBatch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight++;
+        }
+        Watched *job = &entry;
+        std::string path = entry.model.path;
+        pool.Enqueue([this, job, path]() {
+            job->staging->Import(path);
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight--;
+            completed.push_back(job);
+            idle.notify_all();
+        });
+    }
+
+    static bool endsWith(const std::string &text, const std::string &suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef ASSET_WATCHER_H
+#define ASSET_WATCHER_H
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a file is reported once it has not been written for this long, editors tend to save in several writes
+const double ASSET_WATCH_SETTLE_SECONDS = 0.25;
+
+// Watches a directory tree with inotify for files that are written or moved in, directories created later included.
+// Never blocks: Poll() drains whatever the kernel queued since the last call. Where inotify is not available the
+// watcher stays closed and reports nothing.
+class AssetWatcher
+{
+public:
+    explicit AssetWatcher(const std::string &root)
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0)
+            watchTree(root);
+    }
+
+    ~AssetWatcher()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    AssetWatcher(const AssetWatcher &) = delete;
+    AssetWatcher &operator=(const AssetWatcher &) = delete;
+
+    bool IsOpen() const
+    {
+        return fd >= 0;
+    }
+
+    // canonical paths of the files changed since the last call that have settled (see ASSET_WATCH_SETTLE_SECONDS)
+    std::vector<std::string> Poll()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        readEvents(now);
+        std::vector<std::string> settled;
+        for (std::unordered_map<std::string, std::chrono::steady_clock::time_point>::iterator it = changed.begin(); it != changed.end();)
+        {
+            if (std::chrono::duration<double>(now - it->second).count() < ASSET_WATCH_SETTLE_SECONDS)
+            {
+                ++it;
+                continue;
+            }
+            settled.push_back(it->first);
+            it = changed.erase(it);
+        }
+        return settled;
+    }
+
+private:
+    int fd;
+    std::unordered_map<int, std::string> directories; // watch descriptor -> canonical directory
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> changed; // path -> last write
+
+    void watchTree(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(path.c_str(), resolved))
+            return;
+        std::string directory(resolved);
+        int watch = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+        if (watch < 0)
+            return;
+        directories[watch] = directory;
+
+        DIR *listing = opendir(directory.c_str());
+        if (!listing)
+            return;
+        while (dirent *entry = readdir(listing))
+        {
+            std::string name = entry->d_name;
+            if (entry->d_type == DT_DIR && name != "." && name != "..")
+                watchTree(directory + '/' + name);
+        }
+        closedir(listing);
+    }
+
+    void readEvents(std::chrono::steady_clock::time_point now)
+    {
+        if (fd < 0)
+            return;
+        alignas(inotify_event) char buffer[4096];
+        for (;;)
+        {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return;
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event *event = (const inotify_event *)(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                std::unordered_map<int, std::string>::iterator directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0)
+                    continue;
+                std::string path = directory->second + '/' + event->name;
+                if (event->mask & IN_ISDIR)
+                {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                        watchTree(path);
+                }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                {
+                    changed[path] = now;
+                }
+            }
+        }
+    }
+};
+
+#endif
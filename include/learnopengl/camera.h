@@ -66,6 +66,12 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // how many pixels an object of size 1 spans at distance 1 for a viewport of the given height
+    float PixelsPerUnit(float viewportHeight)
+    {
+        return viewportHeight / (2.0f * tan(glm::radians(Zoom) * 0.5f));
+    }
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
@@ -0,0 +1,172 @@
+#ifndef CUBEMAP_PACK_H
+#define CUBEMAP_PACK_H
+
+#include <stb_image.h>
+
+#include <learnopengl/image_kernels.h>
+#include <learnopengl/mapped_file.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Packed cubemaps: the six faces of a cubemap with their mip chains in one file, laid out so the loader maps it
+// once and uploads every level straight from the mapping. Packs are written by the texture_baker tool for each
+// directory holding right/left/top/bottom/front/back images and stored next to it as "<directory>.cubemap".
+//
+// layout: CubemapPackHeader, then for each face in +X, -X, +Y, -Y, +Z, -Z order its levels from the largest one
+// down to 1x1, RGBA8 with tightly packed rows. Mips are filtered in linear space (the faces are color images).
+
+const uint32_t CUBEMAP_PACK_MAGIC = 0x4b504243; // "CBPK"
+const uint32_t CUBEMAP_PACK_VERSION = 1;
+
+struct CubemapPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t faceSize;
+    uint32_t levelCount;
+    uint64_t facesHash; // of the face file names, a pack only stands in for the list it was made from
+};
+
+// the face file names of a cubemap directory, in the order GL numbers the faces
+const char *const CUBEMAP_FACE_NAMES[6] = {"right", "left", "top", "bottom", "front", "back"};
+
+inline std::string CubemapPackPath(const std::vector<std::string> &faces)
+{
+    return faces[0].substr(0, faces[0].find_last_of('/')) + ".cubemap";
+}
+
+inline uint64_t CubemapFacesHash(const std::vector<std::string> &faces)
+{
+    uint64_t hash = HashBytes(nullptr, 0);
+    for (const std::string &face : faces)
+    {
+        std::string name = face.substr(face.find_last_of('/') + 1) + '\n';
+        hash = HashBytes(name.data(), name.size(), hash);
+    }
+    return hash;
+}
+
+// a pack is used while it is at least as new as every face
+inline bool CubemapPackIsFresh(const std::vector<std::string> &faces)
+{
+    struct stat pack, face;
+    if (faces.size() != 6 || stat(CubemapPackPath(faces).c_str(), &pack) != 0)
+        return false;
+    for (const std::string &path : faces)
+        if (stat(path.c_str(), &face) == 0 && face.st_mtime > pack.st_mtime)
+            return false;
+    return true;
+}
+
+inline size_t CubemapLevelBytes(uint32_t faceSize, unsigned int level)
+{
+    size_t size = std::max(1u, faceSize >> level);
+    return size * size * 4;
+}
+
+// read-only view of a packed cubemap
+class CubemapPack
+{
+public:
+    CubemapPackHeader header;
+
+    // maps the pack of faces and validates it against them
+    bool Open(const std::vector<std::string> &faces)
+    {
+        if (!file.open(CubemapPackPath(faces)) || file.size < sizeof(CubemapPackHeader))
+            return fail();
+        memcpy(&header, file.data, sizeof(header));
+        if (header.magic != CUBEMAP_PACK_MAGIC || header.version != CUBEMAP_PACK_VERSION ||
+            header.facesHash != CubemapFacesHash(faces) || header.faceSize == 0 || header.levelCount == 0 || header.levelCount > 32)
+            return fail();
+        faceBytes = 0;
+        for (unsigned int level = 0; level < header.levelCount; level++)
+            faceBytes += CubemapLevelBytes(header.faceSize, level);
+        if (file.size != sizeof(CubemapPackHeader) + 6 * faceBytes)
+            return fail();
+        return true;
+    }
+
+    // pixels of one level of one face, inside the mapping
+    const unsigned char *Level(unsigned int face, unsigned int level) const
+    {
+        size_t offset = sizeof(CubemapPackHeader) + face * faceBytes;
+        for (unsigned int i = 0; i < level; i++)
+            offset += CubemapLevelBytes(header.faceSize, i);
+        return file.data + offset;
+    }
+
+    int LevelSize(unsigned int level) const
+    {
+        return std::max(1u, header.faceSize >> level);
+    }
+
+private:
+    MappedFile file;
+    size_t faceBytes = 0;
+
+    bool fail()
+    {
+        file.close();
+        return false;
+    }
+};
+
+// writes the pack of six square faces of one size, returns false if they cannot be packed
+inline bool PackCubemap(const std::vector<std::string> &faces)
+{
+    if (faces.size() != 6)
+        return false;
+    CubemapPackHeader header = {CUBEMAP_PACK_MAGIC, CUBEMAP_PACK_VERSION, 0, 0, CubemapFacesHash(faces)};
+    std::vector<unsigned char> payload;
+    for (const std::string &path : faces)
+    {
+        int width, height, components;
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 4);
+        if (!data)
+            return false;
+        if (width != height || (header.faceSize != 0 && (int)header.faceSize != width))
+        {
+            stbi_image_free(data);
+            return false;
+        }
+        header.faceSize = width;
+        header.levelCount = 1;
+        while ((header.faceSize >> header.levelCount) > 0)
+            header.levelCount++;
+
+        size_t offset = payload.size();
+        payload.insert(payload.end(), data, data + (size_t)width * width * 4);
+        stbi_image_free(data);
+        for (unsigned int level = 1; level < header.levelCount; level++)
+        {
+            size_t next = payload.size();
+            payload.resize(next + CubemapLevelBytes(header.faceSize, level));
+            int size = std::max(1u, header.faceSize >> (level - 1));
+            DownsampleImage(payload.data() + offset, size, size, 4, true, payload.data() + next);
+            offset = next;
+        }
+    }
+
+    std::string targetPath = CubemapPackPath(faces);
+    std::string tempPath = targetPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)payload.data(), payload.size());
+    out.close();
+    if (!out)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return rename(tempPath.c_str(), targetPath.c_str()) == 0;
+}
+
+#endif
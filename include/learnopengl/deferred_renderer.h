@@ -0,0 +1,239 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/light_manager.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+// what the light passes of the last frame covered
+struct DeferredStats {
+    unsigned int lights = 0; // drawn, the others were off screen
+    double pixels = 0.0;     // in their scissor rectangles, over all of them
+};
+
+// Deferred shading. The opaque geometry is drawn once into a G-buffer (albedo, specular map and shininess, normal,
+// depth) with gbuffer.fs, then every light of a LightManager is drawn as a full screen triangle scissored to
+// the screen rectangle of its influence sphere, adding onto a light accumulation buffer with the light shader. A last
+// pass resolves the accumulation into the scene color and bright color attachments the bloom chain reads, so the
+// passes after it do not see a difference. The depth texture is shared with the scene framebuffer: attach
+// DepthTexture() to it so that what is drawn forward afterwards is tested against the deferred geometry.
+class DeferredRenderer
+{
+public:
+    // the shaders are deferred.vs with deferred_light.fs and deferred.vs with deferred_resolve.fs in
+    // resources/shaders. They must outlive the renderer.
+    DeferredRenderer(Shader &lightShader, Shader &resolveShader, int width, int height)
+        : lightShader(lightShader), resolveShader(resolveShader), width(width), height(height)
+    {
+        albedo = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        specular = createTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        normal = createTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        depth = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+        accumulation = createTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, specular, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, normal, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        unsigned int attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::DEFERRED_RENDERER:: G-buffer not complete" << std::endl;
+
+        glGenFramebuffers(1, &lightBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, lightBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::DEFERRED_RENDERER:: light accumulation buffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the full screen triangle is made up in the vertex shader, but core profile draws need a vertex array
+        glGenVertexArrays(1, &emptyVAO);
+
+        lightShader.use();
+        lightShader.setInt("gAlbedo", 0);
+        lightShader.setInt("gSpecular", 1);
+        lightShader.setInt("gNormal", 2);
+        lightShader.setInt("gDepth", 3);
+        lightShader.setInt("lightData", LIGHT_DATA_TEXTURE_UNIT);
+        resolveShader.use();
+        resolveShader.setInt("lightAccumulation", 0);
+        resolveShader.setInt("gAlbedo", 1);
+        inverseViewProjectionUniform = lightShader.Uniform<glm::mat4>("inverseViewProjection");
+        lightIndexUniform = lightShader.Uniform<int>("lightIndex");
+        spotLightUniform = lightShader.Uniform<bool>("spotLight");
+    }
+
+    ~DeferredRenderer()
+    {
+        glDeleteFramebuffers(1, &gBuffer);
+        glDeleteFramebuffers(1, &lightBuffer);
+        unsigned int textures[5] = {albedo, specular, normal, depth, accumulation};
+        glDeleteTextures(5, textures);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    DeferredRenderer(const DeferredRenderer &) = delete;
+    DeferredRenderer &operator=(const DeferredRenderer &) = delete;
+
+    unsigned int DepthTexture() const
+    {
+        return depth;
+    }
+
+    // binds and clears the G-buffer, draw the opaque geometry with a shader using gbuffer.fs next. Blending is turned
+    // off: the G-buffer alphas are data (shininess, coverage), not opacity. Light turns it back on.
+    void BeginGeometry()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        clearTransparent();
+        glDisable(GL_BLEND);
+    }
+
+    // lights the G-buffer with the lights uploaded by LightManager::Upload for a frame drawn with projection and view,
+    // and writes the result into the two color attachments of target. Leaves target bound with depth testing, culling
+    // and alpha blending on, the way the forward passes draw.
+    void Light(const LightManager &lights, const glm::mat4 &projection, const glm::mat4 &view, unsigned int target)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, lightBuffer);
+        clearTransparent();
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_SCISSOR_TEST);
+        unsigned int inputs[4] = {albedo, specular, normal, depth};
+        for (int i = 0; i < 4; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, inputs[i]);
+        }
+        glBindVertexArray(emptyVAO);
+
+        stats = DeferredStats();
+        lightShader.use();
+        lightShader.Set(inverseViewProjectionUniform, glm::inverse(projection * view));
+        for (size_t i = 0; i < lights.pointLights.size(); i++)
+            drawLight((int)i, false, lights.pointLights[i].position, LightManager::InfluenceRadius(lights.pointLights[i]), projection, view);
+        for (size_t i = 0; i < lights.spotLights.size(); i++)
+            drawLight((int)i, true, lights.spotLights[i].position, LightManager::InfluenceRadius(lights.spotLights[i]), projection, view);
+        glDisable(GL_SCISSOR_TEST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glDisable(GL_BLEND);
+        resolveShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, accumulation);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, albedo);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    const DeferredStats &Stats() const
+    {
+        return stats;
+    }
+
+private:
+    Shader &lightShader, &resolveShader;
+    int width, height;
+    unsigned int gBuffer, lightBuffer;
+    unsigned int albedo, specular, normal, depth, accumulation;
+    unsigned int emptyVAO;
+    UniformHandle<glm::mat4> inverseViewProjectionUniform;
+    UniformHandle<int> lightIndexUniform;
+    UniformHandle<bool> spotLightUniform;
+    DeferredStats stats;
+
+    unsigned int createTexture(GLenum internalFormat, GLenum format, GLenum type)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    // clears color to 0 (nothing drawn) and depth, keeping the clear color the rest of the frame uses
+    void clearTransparent()
+    {
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    }
+
+    void drawLight(int index, bool spot, const glm::vec3 &position, float radius, const glm::mat4 &projection, const glm::mat4 &view)
+    {
+        int rect[4];
+        if (!scissorRect(position, radius, projection, view, rect))
+            return;
+        glScissor(rect[0], rect[1], rect[2], rect[3]);
+        lightShader.Set(lightIndexUniform, index);
+        lightShader.Set(spotLightUniform, spot);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        stats.lights++;
+        stats.pixels += (double)rect[2] * rect[3];
+    }
+
+    // x, y, width and height of the pixels the sphere may cover, false when it covers none
+    bool scissorRect(const glm::vec3 &position, float radius, const glm::mat4 &projection, const glm::mat4 &view, int rect[4]) const
+    {
+        glm::vec3 center = glm::vec3(view * glm::vec4(position, 1.0f));
+        float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+        float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+        // the camera looks down -z
+        if (-center.z - radius > farPlane)
+            return false;
+        glm::vec2 low(-1.0f), high(1.0f);
+        // a sphere reaching past the near plane may cover any pixel
+        if (radius < FLT_MAX && -center.z - radius > nearPlane)
+        {
+            low = glm::vec2(FLT_MAX);
+            high = glm::vec2(-FLT_MAX);
+            for (int corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+                glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+                glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+                low = glm::min(low, ndc);
+                high = glm::max(high, ndc);
+            }
+            low = glm::max(low, glm::vec2(-1.0f));
+            high = glm::min(high, glm::vec2(1.0f));
+            if (low.x >= high.x || low.y >= high.y)
+                return false;
+        }
+        int x0 = (int)std::floor((low.x * 0.5f + 0.5f) * width), y0 = (int)std::floor((low.y * 0.5f + 0.5f) * height);
+        int x1 = (int)std::ceil((high.x * 0.5f + 0.5f) * width), y1 = (int)std::ceil((high.y * 0.5f + 0.5f) * height);
+        rect[0] = x0;
+        rect[1] = y0;
+        rect[2] = x1 - x0;
+        rect[3] = y1 - y0;
+        return rect[2] > 0 && rect[3] > 0;
+    }
+};
+
+#endif
@@ -0,0 +1,357 @@
+#ifndef GEOMETRY_HEAP_H
+#define GEOMETRY_HEAP_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Process wide home of all mesh geometry: one large vertex buffer per vertex format and one index buffer shared by
+// all of them, suballocated into ranges. Every format has a single VAO reading from its buffer, so meshes of every
+// model draw from the same few buffers with base vertex / first index offsets and loading a mesh creates no GL
+// objects. The buffers keep their names when they grow, and Defragment packs the ranges to close the holes freed
+// meshes leave. Ranges move then, so draws read their offsets from the GeometryRange each time. Only use it from the
+// GL thread.
+
+// initial size of each buffer, they double whenever a range does not fit
+const size_t GEOMETRY_HEAP_INITIAL_BYTES = 16 << 20;
+// index ranges start on this many bytes, so both 16 and 32 bit indices can live in the one buffer
+const size_t GEOMETRY_INDEX_ALIGNMENT = 4;
+
+// a suballocated range, in vertices of its format or in bytes of the index buffer
+struct GeometryRange {
+    size_t offset;
+    size_t count;
+    unsigned int pool;
+};
+
+// owns a range and gives it back when destroyed
+class GeometryAllocation
+{
+public:
+    GeometryAllocation() : range(nullptr) {}
+    ~GeometryAllocation()
+    {
+        Reset();
+    }
+
+    GeometryAllocation(const GeometryAllocation &) = delete;
+    GeometryAllocation &operator=(const GeometryAllocation &) = delete;
+    GeometryAllocation(GeometryAllocation &&other) : range(other.range)
+    {
+        other.range = nullptr;
+    }
+    GeometryAllocation &operator=(GeometryAllocation &&other)
+    {
+        if (this != &other)
+        {
+            Reset();
+            range = other.range;
+            other.range = nullptr;
+        }
+        return *this;
+    }
+
+    const GeometryRange *Range() const { return range; }
+    inline void Reset();
+
+private:
+    friend class GeometryHeap;
+    explicit GeometryAllocation(GeometryRange *range) : range(range) {}
+    GeometryRange *range;
+};
+
+// first fit free list over [0, capacity), neighbouring free blocks are merged
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(size_t capacity = 0) : capacity(capacity)
+    {
+        if (capacity > 0)
+            freeBlocks[0] = capacity;
+    }
+
+    bool Allocate(size_t count, size_t alignment, size_t &offset)
+    {
+        for (std::map<size_t, size_t>::iterator it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+        {
+            size_t start = (it->first + alignment - 1) / alignment * alignment;
+            size_t end = it->first + it->second;
+            if (start + count > end)
+                continue;
+            size_t blockStart = it->first;
+            freeBlocks.erase(it);
+            if (start > blockStart)
+                freeBlocks[blockStart] = start - blockStart;
+            if (start + count < end)
+                freeBlocks[start + count] = end - start - count;
+            offset = start;
+            return true;
+        }
+        return false;
+    }
+
+    void Free(size_t offset, size_t count)
+    {
+        std::map<size_t, size_t>::iterator next = freeBlocks.lower_bound(offset);
+        if (next != freeBlocks.end() && offset + count == next->first)
+        {
+            count += next->second;
+            next = freeBlocks.erase(next);
+        }
+        if (next != freeBlocks.begin())
+        {
+            std::map<size_t, size_t>::iterator previous = std::prev(next);
+            if (previous->first + previous->second == offset)
+            {
+                previous->second += count;
+                return;
+            }
+        }
+        freeBlocks[offset] = count;
+    }
+
+    // adds [capacity, newCapacity) as free
+    void Grow(size_t newCapacity)
+    {
+        Free(capacity, newCapacity - capacity);
+        capacity = newCapacity;
+    }
+
+    // everything from used on is free, what lies before is taken
+    void Reset(size_t used)
+    {
+        freeBlocks.clear();
+        if (used < capacity)
+            freeBlocks[used] = capacity - used;
+    }
+
+    size_t Capacity() const { return capacity; }
+
+private:
+    size_t capacity;
+    std::map<size_t, size_t> freeBlocks; // offset -> size
+};
+
+class GeometryHeap
+{
+public:
+    // pool of the index buffer, vertex formats are numbered from 1 on
+    static const unsigned int INDEX_POOL = 0;
+
+    static GeometryHeap &Instance()
+    {
+        static GeometryHeap heap;
+        return heap;
+    }
+
+    // uploads count vertices of stride bytes into the buffer of format (1 and up). setAttributes sets the format's
+    // attribute pointers on the bound VAO and vertex buffer, it runs once when the format's VAO is created. Null data
+    // only takes the range, see Write.
+    GeometryAllocation AllocateVertices(unsigned int format, size_t stride, void (*setAttributes)(), const void *data, size_t count)
+    {
+        Pool &pool = poolFor(format, stride, setAttributes);
+        return upload(format, pool, data, count, 1);
+    }
+
+    // uploads count indices of type (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT) into the index buffer, narrowing them to 16
+    // bits for GL_UNSIGNED_SHORT
+    GeometryAllocation AllocateIndices(const unsigned int *indices, size_t count, GLenum type)
+    {
+        if (type == GL_UNSIGNED_SHORT)
+        {
+            std::vector<uint16_t> narrowed(indices, indices + count);
+            return AllocateIndexData(narrowed.data(), count, type);
+        }
+        return AllocateIndexData(indices, count, type);
+    }
+
+    // same for indices that already are of type, null data only takes the range
+    GeometryAllocation AllocateIndexData(const void *data, size_t count, GLenum type)
+    {
+        Pool &pool = poolFor(INDEX_POOL, 1, nullptr);
+        size_t size = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        return upload(INDEX_POOL, pool, data, count * size, GEOMETRY_INDEX_ALIGNMENT);
+    }
+
+    // fills count units of range (vertices of its format, bytes of the index buffer) from offset units into it
+    void Write(const GeometryRange *range, size_t offset, const void *data, size_t count)
+    {
+        const Pool &pool = pools[range->pool];
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (range->offset + offset) * pool.stride, count * pool.stride, data);
+    }
+
+    // the VAO of a vertex format, with the shared index buffer bound. 0 before the format's first allocation.
+    unsigned int VertexArray(unsigned int format) const
+    {
+        return format < pools.size() ? pools[format].vertexArray : 0;
+    }
+
+    // moves every range to the front of its buffer, in place, so the free space is one block at the end again
+    void Defragment()
+    {
+        for (Pool &pool : pools)
+        {
+            if (pool.buffer == 0)
+                continue;
+            std::vector<GeometryRange *> live;
+            for (const std::unique_ptr<GeometryRange> &range : pool.ranges)
+                live.push_back(range.get());
+            std::sort(live.begin(), live.end(), [](const GeometryRange *a, const GeometryRange *b) { return a->offset < b->offset; });
+
+            size_t alignment = &pool == &pools[INDEX_POOL] ? GEOMETRY_INDEX_ALIGNMENT : 1;
+            size_t packed = 0;
+            bool moves = false;
+            for (GeometryRange *range : live)
+            {
+                packed = (packed + alignment - 1) / alignment * alignment;
+                moves = moves || range->offset != packed;
+                packed += range->count;
+            }
+            if (!moves)
+                continue;
+
+            // ranges of one buffer may not overlap in a copy, so pack into a scratch buffer and copy that back
+            unsigned int scratch;
+            glGenBuffers(1, &scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, packed * pool.stride, nullptr, GL_STREAM_COPY);
+            glBindBuffer(GL_COPY_READ_BUFFER, pool.buffer);
+            size_t offset = 0;
+            for (GeometryRange *range : live)
+            {
+                offset = (offset + alignment - 1) / alignment * alignment;
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range->offset * pool.stride, offset * pool.stride, range->count * pool.stride);
+                range->offset = offset;
+                offset += range->count;
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, packed * pool.stride);
+            glDeleteBuffers(1, &scratch);
+            pool.allocator.Reset(packed);
+        }
+    }
+
+    // bytes held by live ranges, and the size of all buffers together
+    size_t UsedBytes() const
+    {
+        size_t used = 0;
+        for (const Pool &pool : pools)
+            for (const std::unique_ptr<GeometryRange> &range : pool.ranges)
+                used += range->count * pool.stride;
+        return used;
+    }
+
+    size_t CapacityBytes() const
+    {
+        size_t capacity = 0;
+        for (const Pool &pool : pools)
+            capacity += pool.allocator.Capacity() * pool.stride;
+        return capacity;
+    }
+
+private:
+    friend class GeometryAllocation;
+
+    struct Pool {
+        unsigned int buffer = 0;
+        unsigned int vertexArray = 0; // vertex pools only
+        size_t stride = 1;
+        RangeAllocator allocator;
+        std::vector<std::unique_ptr<GeometryRange>> ranges;
+    };
+    std::vector<Pool> pools;
+
+    GeometryHeap() = default;
+
+    Pool &poolFor(unsigned int format, size_t stride, void (*setAttributes)())
+    {
+        if (format >= pools.size())
+            pools.resize(format + 1);
+        Pool &pool = pools[format];
+        if (pool.buffer != 0)
+            return pool;
+
+        pool.stride = stride;
+        pool.allocator = RangeAllocator(GEOMETRY_HEAP_INITIAL_BYTES / stride);
+        glGenBuffers(1, &pool.buffer);
+        // the copy targets touch no VAO state, unlike GL_ELEMENT_ARRAY_BUFFER
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, pool.allocator.Capacity() * stride, nullptr, GL_STATIC_DRAW);
+        if (format != INDEX_POOL)
+        {
+            unsigned int indexBuffer = poolFor(INDEX_POOL, 1, nullptr).buffer;
+            glGenVertexArrays(1, &pool.vertexArray);
+            glBindVertexArray(pool.vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, pool.buffer);
+            setAttributes();
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+            glBindVertexArray(0);
+        }
+        return pools[format];
+    }
+
+    GeometryAllocation upload(unsigned int format, Pool &pool, const void *data, size_t count, size_t alignment)
+    {
+        size_t offset;
+        while (!pool.allocator.Allocate(count, alignment, offset))
+            grow(pool, std::max(pool.allocator.Capacity() * 2, pool.allocator.Capacity() + count + alignment));
+        if (data)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset * pool.stride, count * pool.stride, data);
+        }
+        pool.ranges.emplace_back(new GeometryRange{offset, count, format});
+        return GeometryAllocation(pool.ranges.back().get());
+    }
+
+    // reallocates the buffer under the same name, so the VAOs keep pointing at it, and carries the contents over
+    void grow(Pool &pool, size_t newCapacity)
+    {
+        size_t bytes = pool.allocator.Capacity() * pool.stride;
+        unsigned int scratch;
+        glGenBuffers(1, &scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_COPY);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * pool.stride, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glDeleteBuffers(1, &scratch);
+        pool.allocator.Grow(newCapacity);
+    }
+
+    // only bookkeeping, so ranges can still be given back after the GL context is gone
+    void free(GeometryRange *range)
+    {
+        Pool &pool = pools[range->pool];
+        pool.allocator.Free(range->offset, range->count);
+        for (std::unique_ptr<GeometryRange> &owned : pool.ranges)
+        {
+            if (owned.get() != range)
+                continue;
+            owned = std::move(pool.ranges.back());
+            pool.ranges.pop_back();
+            return;
+        }
+    }
+};
+
+inline void GeometryAllocation::Reset()
+{
+    if (range)
+        GeometryHeap::Instance().free(range);
+    range = nullptr;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad was generated for the 3.3 core profile without extensions, the few extension tokens we use live here.
+
+// EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// ARB_parallel_shader_compile / KHR_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
+// ARB_get_program_binary, core since 4.1. Its entry points are not in glad, LoadGLExtensions fetches them.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+// extension entry points, null where the driver does not have them
+struct GLExtensionProcs {
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+};
+
+inline GLExtensionProcs &GLExtensions()
+{
+    static GLExtensionProcs procs;
+    return procs;
+}
+
+// fetches the entry points above, call with the loader glad was loaded with
+inline void LoadGLExtensions(GLADloadproc load)
+{
+    GLExtensionProcs &procs = GLExtensions();
+    procs.getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+    procs.programBinary = (ProgramBinaryProc)load("glProgramBinary");
+    procs.programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+}
+
+// returns whether the current context exposes the extension. Needs a current context.
+inline bool HasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// S3TC (BC1/BC3) support, queried once. The first call has to happen on the GL thread, later calls are safe anywhere.
+inline bool CompressedTexturesSupported()
+{
+    static bool supported = HasGLExtension("GL_EXT_texture_compression_s3tc");
+    return supported;
+}
+
+// whether the driver compiles and links shaders on threads of its own, so a program can be polled for completion
+// (GL_COMPLETION_STATUS_ARB) instead of stalling on its status. Same threading rules as above.
+inline bool ParallelShaderCompileSupported()
+{
+    static bool supported = HasGLExtension("GL_ARB_parallel_shader_compile") || HasGLExtension("GL_KHR_parallel_shader_compile");
+    return supported;
+}
+
+// whether programs can be saved and loaded as driver binaries. Needs LoadGLExtensions, same threading rules as above.
+inline bool ProgramBinariesSupported()
+{
+    static bool supported = [] {
+        const GLExtensionProcs &procs = GLExtensions();
+        if (!procs.getProgramBinary || !procs.programBinary || !procs.programParameteri)
+            return false;
+        // GLX hands out entry points for any name, so the version or the extension has to vouch for them
+        bool core = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+        if (!core && !HasGLExtension("GL_ARB_get_program_binary"))
+            return false;
+        // some drivers expose the extension but no format to save in
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported;
+}
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IMAGE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// CPU image kernels used while preparing textures on worker threads: 2x2 box downsampling for mip chains (in
+// stored values or sRGB correct), vertical flip and RGB to RGBA expansion. Each kernel has a scalar version and,
+// on x86, SSE4.1 and AVX2 versions compiled through target attributes, so the build needs no -march flags;
+// BestImageKernels() picks the widest one the CPU supports. Every version produces exactly the same bytes.
+//
+// Downsampling halves each dimension, rounding down but never below 1. With an odd size the last row or column
+// only contributes to the level above, like glGenerateMipmap does on most drivers.
+
+struct ImageKernels {
+    const char *name;
+    // 2x2 box filter of an RGBA8 image into a max(1, width / 2) x max(1, height / 2) one
+    void (*downsampleRGBA8)(const unsigned char *source, int width, int height, unsigned char *destination);
+    // width x height RGB8 pixels to RGBA8 with an opaque alpha
+    void (*expandRGBToRGBA)(const unsigned char *source, unsigned char *destination, size_t pixelCount);
+    // reverses the order of rows in place
+    void (*flipRows)(unsigned char *data, size_t rowBytes, int rows);
+};
+
+inline int MipDimension(int size)
+{
+    return std::max(1, size / 2);
+}
+
+// scalar
+// ------
+inline void DownsampleScalar(const unsigned char *source, int width, int height, int channels, unsigned char *destination)
+{
+    int nextWidth = MipDimension(width), nextHeight = MipDimension(height);
+    for (int y = 0; y < nextHeight; y++)
+    {
+        const unsigned char *row0 = source + (size_t)std::min(2 * y, height - 1) * width * channels;
+        const unsigned char *row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+        unsigned char *out = destination + (size_t)y * nextWidth * channels;
+        for (int x = 0; x < nextWidth; x++)
+        {
+            int x0 = std::min(2 * x, width - 1) * channels, x1 = std::min(2 * x + 1, width - 1) * channels;
+            for (int c = 0; c < channels; c++)
+                out[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+inline void DownsampleRGBA8Scalar(const unsigned char *source, int width, int height, unsigned char *destination)
+{
+    DownsampleScalar(source, width, height, 4, destination);
+}
+
+inline void ExpandRGBToRGBAScalar(const unsigned char *source, unsigned char *destination, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        destination[i * 4 + 0] = source[i * 3 + 0];
+        destination[i * 4 + 1] = source[i * 3 + 1];
+        destination[i * 4 + 2] = source[i * 3 + 2];
+        destination[i * 4 + 3] = 255;
+    }
+}
+
+inline void SwapBytesScalar(unsigned char *a, unsigned char *b, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        std::swap(a[i], b[i]);
+}
+
+inline void FlipRowsScalar(unsigned char *data, size_t rowBytes, int rows)
+{
+    for (int y = 0; y < rows / 2; y++)
+        SwapBytesScalar(data + y * rowBytes, data + (rows - 1 - y) * rowBytes, rowBytes);
+}
+
+inline const ImageKernels &ScalarImageKernels()
+{
+    static const ImageKernels kernels = {"scalar", DownsampleRGBA8Scalar, ExpandRGBToRGBAScalar, FlipRowsScalar};
+    return kernels;
+}
+
+#ifdef IMAGE_KERNELS_X86
+// SSE4.1
+// ------
+__attribute__((target("sse4.1")))
+inline void DownsampleRGBA8SSE41(const unsigned char *source, int width, int height, unsigned char *destination)
+{
+    if (width < 2 || height < 2)
+        return DownsampleScalar(source, width, height, 4, destination);
+    int nextWidth = width / 2, nextHeight = height / 2;
+    const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+    for (int y = 0; y < nextHeight; y++)
+    {
+        const unsigned char *row0 = source + (size_t)(2 * y) * width * 4;
+        const unsigned char *row1 = row0 + (size_t)width * 4;
+        unsigned char *out = destination + (size_t)y * nextWidth * 4;
+        int x = 0;
+        // 4 source pixels of both rows give 2 destination pixels
+        for (; x + 2 <= nextWidth; x += 2)
+        {
+            __m128i top = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+            __m128i bottom = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(sum, sum));
+        }
+        for (; x < nextWidth; x++)
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (unsigned char)((row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c] + 2) >> 2);
+    }
+}
+
+__attribute__((target("sse4.1")))
+inline void ExpandRGBToRGBASSE41(const unsigned char *source, unsigned char *destination, size_t pixelCount)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    size_t i = 0;
+    // each 16 byte load covers 4 pixels plus 4 bytes of the next ones, stop before reading past the end
+    for (; i + 6 <= pixelCount; i += 4)
+    {
+        __m128i rgb = _mm_loadu_si128((const __m128i *)(source + i * 3));
+        _mm_storeu_si128((__m128i *)(destination + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+    }
+    ExpandRGBToRGBAScalar(source + i * 3, destination + i * 4, pixelCount - i);
+}
+
+__attribute__((target("sse4.1")))
+inline void FlipRowsSSE41(unsigned char *data, size_t rowBytes, int rows)
+{
+    for (int y = 0; y < rows / 2; y++)
+    {
+        unsigned char *top = data + y * rowBytes;
+        unsigned char *bottom = data + (rows - 1 - y) * rowBytes;
+        size_t i = 0;
+        for (; i + 16 <= rowBytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(top + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(bottom + i));
+            _mm_storeu_si128((__m128i *)(top + i), b);
+            _mm_storeu_si128((__m128i *)(bottom + i), a);
+        }
+        SwapBytesScalar(top + i, bottom + i, rowBytes - i);
+    }
+}
+
+// AVX2
+// ----
+__attribute__((target("avx2")))
+inline void DownsampleRGBA8AVX2(const unsigned char *source, int width, int height, unsigned char *destination)
+{
+    if (width < 2 || height < 2)
+        return DownsampleScalar(source, width, height, 4, destination);
+    int nextWidth = width / 2, nextHeight = height / 2;
+    const __m256i zero = _mm256_setzero_si256(), two = _mm256_set1_epi16(2);
+    for (int y = 0; y < nextHeight; y++)
+    {
+        const unsigned char *row0 = source + (size_t)(2 * y) * width * 4;
+        const unsigned char *row1 = row0 + (size_t)width * 4;
+        unsigned char *out = destination + (size_t)y * nextWidth * 4;
+        int x = 0;
+        // 8 source pixels of both rows give 4 destination pixels, the unpacks work per 128 bit lane
+        for (; x + 4 <= nextWidth; x += 4)
+        {
+            __m256i top = _mm256_loadu_si256((const __m256i *)(row0 + x * 8));
+            __m256i bottom = _mm256_loadu_si256((const __m256i *)(row1 + x * 8));
+            __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bottom, zero));
+            __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(top, zero), _mm256_unpackhi_epi8(bottom, zero));
+            __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), _mm256_unpackhi_epi64(low, high));
+            sum = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i *)(out + x * 4), _mm256_castsi256_si128(packed));
+        }
+        for (; x < nextWidth; x++)
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (unsigned char)((row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c] + 2) >> 2);
+    }
+}
+
+__attribute__((target("avx2")))
+inline void ExpandRGBToRGBAAVX2(const unsigned char *source, unsigned char *destination, size_t pixelCount)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+    size_t i = 0;
+    // two 16 byte loads 12 bytes apart cover 8 pixels, the second one reads 4 bytes past them
+    for (; i + 10 <= pixelCount; i += 8)
+    {
+        __m128i low = _mm_loadu_si128((const __m128i *)(source + i * 3));
+        __m128i high = _mm_loadu_si128((const __m128i *)(source + i * 3 + 12));
+        __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256((__m256i *)(destination + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+    }
+    ExpandRGBToRGBAScalar(source + i * 3, destination + i * 4, pixelCount - i);
+}
+
+__attribute__((target("avx2")))
+inline void FlipRowsAVX2(unsigned char *data, size_t rowBytes, int rows)
+{
+    for (int y = 0; y < rows / 2; y++)
+    {
+        unsigned char *top = data + y * rowBytes;
+        unsigned char *bottom = data + (rows - 1 - y) * rowBytes;
+        size_t i = 0;
+        for (; i + 32 <= rowBytes; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(top + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(bottom + i));
+            _mm256_storeu_si256((__m256i *)(top + i), b);
+            _mm256_storeu_si256((__m256i *)(bottom + i), a);
+        }
+        SwapBytesScalar(top + i, bottom + i, rowBytes - i);
+    }
+}
+
+inline const ImageKernels &SSE41ImageKernels()
+{
+    static const ImageKernels kernels = {"sse4.1", DownsampleRGBA8SSE41, ExpandRGBToRGBASSE41, FlipRowsSSE41};
+    return kernels;
+}
+
+inline const ImageKernels &AVX2ImageKernels()
+{
+    static const ImageKernels kernels = {"avx2", DownsampleRGBA8AVX2, ExpandRGBToRGBAAVX2, FlipRowsAVX2};
+    return kernels;
+}
+#endif
+
+// every kernel set this CPU can run, scalar first
+inline std::vector<const ImageKernels *> SupportedImageKernels()
+{
+    std::vector<const ImageKernels *> supported(1, &ScalarImageKernels());
+#ifdef IMAGE_KERNELS_X86
+    if (__builtin_cpu_supports("sse4.1"))
+        supported.push_back(&SSE41ImageKernels());
+    if (__builtin_cpu_supports("avx2"))
+        supported.push_back(&AVX2ImageKernels());
+#endif
+    return supported;
+}
+
+inline const ImageKernels &BestImageKernels()
+{
+    static const ImageKernels &best = *SupportedImageKernels().back();
+    return best;
+}
+
+// sRGB
+// ----
+// 8 bit sRGB to linear, and linear quantized to 12 bits back to 8 bit sRGB
+struct SRGBTables {
+    float toLinear[256];
+    unsigned char fromLinear[4096];
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 4096; i++)
+        {
+            float l = i / 4095.0f;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = (unsigned char)std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f);
+        }
+    }
+};
+
+inline const SRGBTables &GetSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+// 2x2 box filter that averages the color channels in linear space, alpha (if any, always the 4th channel) as is.
+// Table driven and scalar: the per channel lookups leave nothing for the vector units to win.
+inline void DownsampleSRGB(const unsigned char *source, int width, int height, int channels, unsigned char *destination)
+{
+    const SRGBTables &tables = GetSRGBTables();
+    int nextWidth = MipDimension(width), nextHeight = MipDimension(height);
+    int colorChannels = std::min(channels, 3);
+    for (int y = 0; y < nextHeight; y++)
+    {
+        const unsigned char *row0 = source + (size_t)std::min(2 * y, height - 1) * width * channels;
+        const unsigned char *row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+        unsigned char *out = destination + (size_t)y * nextWidth * channels;
+        for (int x = 0; x < nextWidth; x++)
+        {
+            int x0 = std::min(2 * x, width - 1) * channels, x1 = std::min(2 * x + 1, width - 1) * channels;
+            for (int c = 0; c < colorChannels; c++)
+            {
+                float linear = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+                               tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+                out[x * channels + c] = tables.fromLinear[(int)(linear * (4095.0f / 4.0f) + 0.5f)];
+            }
+            for (int c = colorChannels; c < channels; c++)
+                out[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+// next mip level of a width x height image with any channel count, through the fastest kernel available
+inline void DownsampleImage(const unsigned char *source, int width, int height, int channels, bool srgb, unsigned char *destination)
+{
+    if (srgb && channels >= 3)
+        DownsampleSRGB(source, width, height, channels, destination);
+    else if (channels == 4)
+        BestImageKernels().downsampleRGBA8(source, width, height, destination);
+    else
+        DownsampleScalar(source, width, height, channels, destination);
+}
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef LIGHT_ASSIGNMENT_H
+#define LIGHT_ASSIGNMENT_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/light_manager.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// lights of each kind a draw is lit by at most, MAX_OBJECT_LIGHTS in 2.model_lighting.fs
+const int MAX_OBJECT_LIGHTS = 4;
+
+// what the assignment did in the last frame
+struct LightAssignmentStats {
+    unsigned int draws = 0;
+    unsigned int lights = 0;  // assigned, over all draws
+    unsigned int dropped = 0; // reaching a draw that had all its slots taken
+};
+
+// Per object light assignment. Every light is bounded by a sphere from its influence radius (LightManager), for spot
+// lights the sphere around the cone out to that radius. Before an object is drawn its bounding sphere is tested
+// against them, spot lights against the cone itself too, and only the lights that reach it are handed to the shader
+// as index lists, the nearest first when there are more than MAX_OBJECT_LIGHTS.
+class LightAssignment
+{
+public:
+    // the bounding spheres of the lights for this frame. Disabled, the shader goes back to its other light lists.
+    void Update(const LightManager &lights, bool enabled)
+    {
+        this->enabled = enabled;
+        stats = LightAssignmentStats();
+        points.clear();
+        spots.clear();
+        if (!enabled)
+            return;
+        for (const PointLight &light : lights.pointLights)
+        {
+            Bound bound;
+            bound.center = light.position;
+            bound.radius = LightManager::InfluenceRadius(light);
+            points.push_back(bound);
+        }
+        for (const SpotLight &light : lights.spotLights)
+        {
+            Bound bound;
+            bound.tip = light.position;
+            bound.direction = glm::normalize(light.direction);
+            bound.range = LightManager::InfluenceRadius(light);
+            bound.cosAngle = glm::clamp(light.outerCutOff, -1.0f, 1.0f);
+            bound.sinAngle = std::sqrt(1.0f - bound.cosAngle * bound.cosAngle);
+            coneSphere(bound);
+            spots.push_back(bound);
+        }
+    }
+
+    // sets the lights reaching one instance of model drawn with modelMatrix on shader, call right before drawing it
+    void Assign(Shader &shader, const Model &model, const glm::mat4 &modelMatrix)
+    {
+        if (&shader != resolvedFor)
+            resolve(shader);
+        shader.Set(enabledUniform, enabled);
+        if (!enabled)
+            return;
+        glm::vec3 center;
+        float radius;
+        model.BoundingSphere(modelMatrix, center, radius);
+
+        candidates.clear();
+        for (size_t i = 0; i < points.size(); i++)
+            consider(points[i], (int)i, center, radius, false);
+        int pointCount = select(shader, pointUniforms, pointCountUniform);
+        candidates.clear();
+        for (size_t i = 0; i < spots.size(); i++)
+            consider(spots[i], (int)i, center, radius, true);
+        int spotCount = select(shader, spotUniforms, spotCountUniform);
+
+        stats.draws++;
+        stats.lights += pointCount + spotCount;
+    }
+
+    const LightAssignmentStats &Stats() const
+    {
+        return stats;
+    }
+
+private:
+    struct Bound {
+        glm::vec3 center; // bounding sphere
+        float radius;
+        glm::vec3 tip, direction; // the cone of a spot light
+        float range, cosAngle, sinAngle;
+    };
+
+    struct Candidate {
+        int index;
+        float distance; // between the light and the object, relative to the light's radius
+    };
+
+    bool enabled = false;
+    std::vector<Bound> points, spots;
+    std::vector<Candidate> candidates;
+    LightAssignmentStats stats;
+    const Shader *resolvedFor = nullptr;
+    UniformHandle<bool> enabledUniform;
+    UniformHandle<int> pointCountUniform, spotCountUniform;
+    UniformHandle<int> pointUniforms[MAX_OBJECT_LIGHTS], spotUniforms[MAX_OBJECT_LIGHTS];
+
+    void resolve(Shader &shader)
+    {
+        resolvedFor = &shader;
+        enabledUniform = shader.Uniform<bool>("objectLightsEnabled");
+        pointCountUniform = shader.Uniform<int>("objectPointLightCount");
+        spotCountUniform = shader.Uniform<int>("objectSpotLightCount");
+        for (int i = 0; i < MAX_OBJECT_LIGHTS; i++)
+        {
+            pointUniforms[i] = shader.Uniform<int>("objectPointLights[" + std::to_string(i) + "]");
+            spotUniforms[i] = shader.Uniform<int>("objectSpotLights[" + std::to_string(i) + "]");
+        }
+    }
+
+    // the smallest sphere around a cone of a spot light: around the cap for wide cones, else through the tip and the
+    // rim of the cap
+    static void coneSphere(Bound &bound)
+    {
+        if (bound.range >= FLT_MAX)
+        {
+            bound.center = bound.tip;
+            bound.radius = FLT_MAX;
+        }
+        else if (bound.cosAngle < std::sqrt(0.5f))
+        {
+            bound.center = bound.tip + bound.direction * (bound.range * std::max(bound.cosAngle, 0.0f));
+            bound.radius = bound.cosAngle > 0.0f ? bound.range * bound.sinAngle : bound.range;
+        }
+        else
+        {
+            bound.radius = bound.range / (2.0f * bound.cosAngle);
+            bound.center = bound.tip + bound.direction * bound.radius;
+        }
+    }
+
+    void consider(const Bound &bound, int index, const glm::vec3 &center, float radius, bool cone)
+    {
+        float distance = glm::length(center - bound.center);
+        if (distance > bound.radius + radius)
+            return;
+        if (cone && !sphereInCone(bound, center, radius))
+            return;
+        Candidate candidate;
+        candidate.index = index;
+        candidate.distance = bound.radius < FLT_MAX ? std::max(distance - radius, 0.0f) / bound.radius : 0.0f;
+        candidates.push_back(candidate);
+    }
+
+    static bool sphereInCone(const Bound &bound, const glm::vec3 &center, float radius)
+    {
+        glm::vec3 v = center - bound.tip;
+        float along = glm::dot(v, bound.direction);
+        float across = std::sqrt(std::max(glm::dot(v, v) - along * along, 0.0f));
+        // distance of the center to the cone surface
+        float outside = across * bound.cosAngle - along * bound.sinAngle;
+        return !(outside > radius || along > radius + bound.range || along < -radius);
+    }
+
+    // writes the candidates into the index uniforms, the nearest when there are too many, returns how many
+    int select(Shader &shader, UniformHandle<int> *uniforms, UniformHandle<int> countUniform)
+    {
+        int count = (int)candidates.size();
+        if (count > MAX_OBJECT_LIGHTS)
+        {
+            std::partial_sort(candidates.begin(), candidates.begin() + MAX_OBJECT_LIGHTS, candidates.end(),
+                              [](const Candidate &a, const Candidate &b) { return a.distance < b.distance; });
+            stats.dropped += count - MAX_OBJECT_LIGHTS;
+            count = MAX_OBJECT_LIGHTS;
+        }
+        for (int i = 0; i < count; i++)
+            shader.Set(uniforms[i], candidates[i].index);
+        shader.Set(countUniform, count);
+        return count;
+    }
+};
+
+#endif
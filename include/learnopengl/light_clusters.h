@@ -0,0 +1,472 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/light_manager.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/uniform_buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE2__)
+#define LIGHT_CLUSTERS_SSE 1
+#include <emmintrin.h>
+#endif
+
+// froxels: screen tiles times depth slices, the slices spaced exponentially between the near and far plane
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 9;
+const int CLUSTER_GRID_Z = 24;
+const int CLUSTERS_PER_SLICE = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+
+// texture units of the cluster grid and the light index lists, below LIGHT_DATA_TEXTURE_UNIT
+const int CLUSTER_GRID_TEXTURE_UNIT = 14;
+const int CLUSTER_LIGHTS_TEXTURE_UNIT = 13;
+
+static_assert(CLUSTERS_PER_SLICE % 4 == 0, "a slice is tested 4 clusters at a time");
+
+// what binning the lights took in the last frame
+struct LightClusterStats {
+    double milliseconds = 0.0;
+    unsigned int indices = 0;       // light references over all clusters
+    unsigned int maxPerCluster = 0;
+    unsigned int clustersLit = 0;   // clusters with at least one light
+};
+
+// Clustered forward lighting. Every frame the lights of a LightManager are binned on the CPU into the froxels of the
+// camera frustum: each light's bounding sphere, and for spot lights its cone too, is tested against the view space
+// bounds of the clusters it may reach, 4 clusters at a time with SSE where available, one depth slice per task on the
+// thread pool. The result goes to the lighting shader through two texture buffers:
+//   clusterGrid   (RG32UI, one texel per cluster): offset of its list in clusterLights, point count | spot count << 16
+//   clusterLights (R32UI): per cluster the indices of its point lights, then of its spot lights
+// and the grid parameters through the Clusters uniform block. The fragment shader finds its cluster from
+// gl_FragCoord and its view depth and only evaluates the lights listed there.
+class LightClusters
+{
+public:
+    explicit LightClusters(ThreadPool &pool)
+        : pool(pool), uniformBuffer("Clusters", CLUSTERS_UNIFORM_BINDING), boundsWidth(0), boundsHeight(0),
+          indexCapacity(0)
+    {
+        glGenBuffers(2, buffers);
+        glGenTextures(2, textures);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t) * 2 * CLUSTERS_PER_SLICE * CLUSTER_GRID_Z, NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[0]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, buffers[0]);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[1]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, buffers[1]);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        grid.resize(2 * CLUSTERS_PER_SLICE * CLUSTER_GRID_Z);
+        slices.resize(CLUSTER_GRID_Z);
+    }
+
+    ~LightClusters()
+    {
+        glDeleteTextures(2, textures);
+        glDeleteBuffers(2, buffers);
+    }
+
+    LightClusters(const LightClusters &) = delete;
+    LightClusters &operator=(const LightClusters &) = delete;
+
+    // bins the lights for a frame drawn with projection and view into a viewport of the given size, uploads the
+    // clusters and binds them for drawing. Disabled, the shader goes through all the lights. Once per frame on the GL
+    // thread, after LightManager::Upload.
+    void Update(const LightManager &lights, const glm::mat4 &projection, const glm::mat4 &view, int width, int height, bool enabled)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (projection != boundsProjection || width != boundsWidth || height != boundsHeight)
+            computeBounds(projection, width, height);
+
+        ClusterUniforms uniforms;
+        uniforms.gridX = CLUSTER_GRID_X;
+        uniforms.gridY = CLUSTER_GRID_Y;
+        uniforms.gridZ = CLUSTER_GRID_Z;
+        uniforms.enabled = enabled ? 1 : 0;
+        uniforms.tileScaleX = (float)CLUSTER_GRID_X / width;
+        uniforms.tileScaleY = (float)CLUSTER_GRID_Y / height;
+        uniforms.sliceScale = sliceScale;
+        uniforms.sliceBias = sliceBias;
+        uniformBuffer.Update(uniforms);
+        if (!enabled)
+        {
+            stats = LightClusterStats();
+            return;
+        }
+
+        prepareLights(lights, view);
+        parallelFor(CLUSTER_GRID_Z, [this](int slice) { binSlice(slice); });
+
+        // the slices were binned apart, their lists go after each other
+        indices.clear();
+        stats = LightClusterStats();
+        for (int slice = 0; slice < CLUSTER_GRID_Z; slice++)
+        {
+            const Slice &binned = slices[slice];
+            uint32_t base = (uint32_t)indices.size();
+            for (int cluster = 0; cluster < CLUSTERS_PER_SLICE; cluster++)
+            {
+                size_t texel = 2 * (slice * CLUSTERS_PER_SLICE + cluster);
+                grid[texel] = base + binned.offsets[cluster];
+                grid[texel + 1] = binned.counts[cluster];
+                unsigned int count = (binned.counts[cluster] & 0xffff) + (binned.counts[cluster] >> 16);
+                stats.maxPerCluster = std::max(stats.maxPerCluster, count);
+                stats.clustersLit += count > 0;
+            }
+            indices.insert(indices.end(), binned.indices.begin(), binned.indices.end());
+        }
+        stats.indices = (unsigned int)indices.size();
+        upload();
+        stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const LightClusterStats &Stats() const
+    {
+        return stats;
+    }
+
+private:
+    // view space bounds of the clusters, structure of arrays so 4 neighbours load at once. The clusters of a slice
+    // are stored after each other, x fastest.
+    struct Bounds {
+        std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+        std::vector<float> centerX, centerY, centerZ, radius; // bounding spheres, for the spot light cones
+    };
+
+    struct Sphere {
+        glm::vec3 center; // view space
+        float radius;
+        int firstSlice, lastSlice;
+    };
+
+    struct Cone {
+        glm::vec3 tip, direction; // view space
+        float cosAngle, sinAngle, range;
+    };
+
+    // the binning of one depth slice
+    struct Slice {
+        std::vector<uint64_t> bits;      // per cluster, one bit per light: the point lights, then the spot lights
+        std::vector<uint32_t> indices;
+        uint32_t offsets[CLUSTERS_PER_SLICE];
+        uint32_t counts[CLUSTERS_PER_SLICE];
+    };
+
+    ThreadPool &pool;
+    // helpers of parallelFor in the pool queue that have not started yet, shared with them as they may outlive this
+    std::shared_ptr<std::atomic<int>> pendingHelpers = std::make_shared<std::atomic<int>>(0);
+    UniformBuffer<ClusterUniforms> uniformBuffer;
+    unsigned int buffers[2], textures[2]; // grid, light indices
+    glm::mat4 boundsProjection;
+    int boundsWidth, boundsHeight;
+    float nearPlane = 0.0f, farPlane = 0.0f, sliceScale = 0.0f, sliceBias = 0.0f;
+    Bounds bounds;
+    std::vector<Sphere> spheres; // point lights, then spot lights
+    std::vector<Cone> cones;     // spot lights
+    size_t pointCount = 0;
+    std::vector<Slice> slices;
+    std::vector<uint32_t> grid, indices;
+    size_t indexCapacity;
+    LightClusterStats stats;
+
+    // the slices hold depths [near * (far / near)^(k / Z), near * (far / near)^((k + 1) / Z)], slice of a depth is
+    // log(depth) * sliceScale + sliceBias
+    void computeBounds(const glm::mat4 &projection, int width, int height)
+    {
+        boundsProjection = projection;
+        boundsWidth = width;
+        boundsHeight = height;
+        nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+        farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+        sliceScale = CLUSTER_GRID_Z / std::log(farPlane / nearPlane);
+        sliceBias = -std::log(nearPlane) * sliceScale;
+
+        size_t count = (size_t)CLUSTERS_PER_SLICE * CLUSTER_GRID_Z;
+        for (std::vector<float> *array : {&bounds.minX, &bounds.minY, &bounds.minZ, &bounds.maxX, &bounds.maxY, &bounds.maxZ,
+                                          &bounds.centerX, &bounds.centerY, &bounds.centerZ, &bounds.radius})
+            array->resize(count);
+
+        glm::mat4 inverse = glm::inverse(projection);
+        for (int z = 0; z < CLUSTER_GRID_Z; z++)
+        {
+            float depths[2] = {sliceDepth(z), sliceDepth(z + 1)};
+            for (int y = 0; y < CLUSTER_GRID_Y; y++)
+            {
+                for (int x = 0; x < CLUSTER_GRID_X; x++)
+                {
+                    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+                    for (int corner = 0; corner < 4; corner++)
+                    {
+                        float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / CLUSTER_GRID_X;
+                        float ndcY = -1.0f + 2.0f * (y + (corner >> 1)) / CLUSTER_GRID_Y;
+                        // on the near plane, then along the ray through it to both depths
+                        glm::vec4 point = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+                        glm::vec3 onNear = glm::vec3(point) / point.w;
+                        for (float depth : depths)
+                        {
+                            glm::vec3 p = onNear * (depth / -onNear.z);
+                            low = glm::min(low, p);
+                            high = glm::max(high, p);
+                        }
+                    }
+                    size_t i = (size_t)z * CLUSTERS_PER_SLICE + y * CLUSTER_GRID_X + x;
+                    bounds.minX[i] = low.x; bounds.minY[i] = low.y; bounds.minZ[i] = low.z;
+                    bounds.maxX[i] = high.x; bounds.maxY[i] = high.y; bounds.maxZ[i] = high.z;
+                    glm::vec3 center = (low + high) * 0.5f;
+                    bounds.centerX[i] = center.x; bounds.centerY[i] = center.y; bounds.centerZ[i] = center.z;
+                    bounds.radius[i] = glm::length(high - center);
+                }
+            }
+        }
+    }
+
+    float sliceDepth(int slice) const
+    {
+        return nearPlane * std::pow(farPlane / nearPlane, (float)slice / CLUSTER_GRID_Z);
+    }
+
+    // the lights in view space with the slices their spheres reach
+    void prepareLights(const LightManager &lights, const glm::mat4 &view)
+    {
+        spheres.clear();
+        cones.clear();
+        pointCount = lights.pointLights.size();
+        for (const PointLight &light : lights.pointLights)
+            spheres.push_back(sphere(view, light.position, LightManager::InfluenceRadius(light)));
+        for (const SpotLight &light : lights.spotLights)
+        {
+            float range = LightManager::InfluenceRadius(light);
+            spheres.push_back(sphere(view, light.position, range));
+            Cone cone;
+            cone.tip = spheres.back().center;
+            cone.direction = glm::normalize(glm::mat3(view) * light.direction);
+            cone.cosAngle = glm::clamp(light.outerCutOff, -1.0f, 1.0f);
+            cone.sinAngle = std::sqrt(1.0f - cone.cosAngle * cone.cosAngle);
+            cone.range = range;
+            cones.push_back(cone);
+        }
+    }
+
+    Sphere sphere(const glm::mat4 &view, const glm::vec3 &position, float radius) const
+    {
+        Sphere sphere;
+        sphere.center = glm::vec3(view * glm::vec4(position, 1.0f));
+        sphere.radius = radius;
+        // the camera looks down -z
+        float nearest = std::max(-sphere.center.z - radius, nearPlane);
+        float farthest = std::min(-sphere.center.z + radius, farPlane);
+        sphere.firstSlice = 0;
+        sphere.lastSlice = -1;
+        if (nearest <= farthest)
+        {
+            sphere.firstSlice = glm::clamp((int)std::floor(std::log(nearest) * sliceScale + sliceBias), 0, CLUSTER_GRID_Z - 1);
+            sphere.lastSlice = glm::clamp((int)std::floor(std::log(farthest) * sliceScale + sliceBias), 0, CLUSTER_GRID_Z - 1);
+        }
+        return sphere;
+    }
+
+    void binSlice(int z)
+    {
+        Slice &slice = slices[z];
+        size_t words = (spheres.size() + 63) / 64;
+        slice.bits.assign(words * CLUSTERS_PER_SLICE, 0);
+        size_t first = (size_t)z * CLUSTERS_PER_SLICE;
+        for (size_t light = 0; light < spheres.size(); light++)
+        {
+            const Sphere &s = spheres[light];
+            if (z < s.firstSlice || z > s.lastSlice)
+                continue;
+            const Cone *cone = light >= pointCount ? &cones[light - pointCount] : nullptr;
+            uint64_t bit = (uint64_t)1 << (light % 64);
+            uint64_t *word = slice.bits.data() + light / 64;
+            for (int cluster = 0; cluster < CLUSTERS_PER_SLICE; cluster += 4)
+            {
+                unsigned int mask = sphereMask(first + cluster, s);
+                if (mask && cone)
+                    mask &= coneMask(first + cluster, *cone);
+                for (; mask; mask &= mask - 1)
+                    word[(cluster + __builtin_ctz(mask)) * words] |= bit;
+            }
+        }
+
+        // the lists, point lights first
+        slice.indices.clear();
+        for (int cluster = 0; cluster < CLUSTERS_PER_SLICE; cluster++)
+        {
+            slice.offsets[cluster] = (uint32_t)slice.indices.size();
+            uint32_t points = 0, spots = 0;
+            const uint64_t *bits = slice.bits.data() + cluster * words;
+            for (size_t w = 0; w < words; w++)
+            {
+                for (uint64_t word = bits[w]; word; word &= word - 1)
+                {
+                    size_t light = w * 64 + __builtin_ctzll(word);
+                    if (light < pointCount)
+                    {
+                        slice.indices.push_back((uint32_t)light);
+                        points++;
+                    }
+                    else
+                    {
+                        slice.indices.push_back((uint32_t)(light - pointCount));
+                        spots++;
+                    }
+                }
+            }
+            slice.counts[cluster] = std::min(points, 0xffffu) | std::min(spots, 0xffffu) << 16;
+        }
+    }
+
+#ifdef LIGHT_CLUSTERS_SSE
+    // which of the 4 clusters from i on the sphere reaches, one bit each
+    unsigned int sphereMask(size_t i, const Sphere &s) const
+    {
+        __m128 zero = _mm_setzero_ps();
+        __m128 distance = zero;
+        const std::vector<float> *low[3] = {&bounds.minX, &bounds.minY, &bounds.minZ};
+        const std::vector<float> *high[3] = {&bounds.maxX, &bounds.maxY, &bounds.maxZ};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            __m128 c = _mm_set1_ps(s.center[axis]);
+            // distance from the center to the box along the axis, 0 inside
+            __m128 d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&(*low[axis])[i]), c),
+                                             _mm_sub_ps(c, _mm_loadu_ps(&(*high[axis])[i]))), zero);
+            distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+        }
+        return (unsigned int)_mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(s.radius * s.radius)));
+    }
+
+    // which of the 4 clusters from i the cone may reach, tested with their bounding spheres
+    unsigned int coneMask(size_t i, const Cone &cone) const
+    {
+        __m128 vx = _mm_sub_ps(_mm_loadu_ps(&bounds.centerX[i]), _mm_set1_ps(cone.tip.x));
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(&bounds.centerY[i]), _mm_set1_ps(cone.tip.y));
+        __m128 vz = _mm_sub_ps(_mm_loadu_ps(&bounds.centerZ[i]), _mm_set1_ps(cone.tip.z));
+        __m128 radius = _mm_loadu_ps(&bounds.radius[i]);
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        // along the axis, and distance of the sphere center to the cone surface
+        __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(cone.direction.x)), _mm_mul_ps(vy, _mm_set1_ps(cone.direction.y))),
+                                  _mm_mul_ps(vz, _mm_set1_ps(cone.direction.z)));
+        __m128 across = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lengthSquared, _mm_mul_ps(along, along)), _mm_setzero_ps()));
+        __m128 outside = _mm_sub_ps(_mm_mul_ps(across, _mm_set1_ps(cone.cosAngle)), _mm_mul_ps(along, _mm_set1_ps(cone.sinAngle)));
+        __m128 culled = _mm_or_ps(_mm_cmpgt_ps(outside, radius),
+                                  _mm_or_ps(_mm_cmpgt_ps(along, _mm_add_ps(radius, _mm_set1_ps(cone.range))),
+                                            _mm_cmplt_ps(along, _mm_sub_ps(_mm_setzero_ps(), radius))));
+        return (unsigned int)_mm_movemask_ps(culled) ^ 0xf;
+    }
+#else
+    unsigned int sphereMask(size_t i, const Sphere &s) const
+    {
+        unsigned int mask = 0;
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            size_t c = i + lane;
+            glm::vec3 low(bounds.minX[c], bounds.minY[c], bounds.minZ[c]), high(bounds.maxX[c], bounds.maxY[c], bounds.maxZ[c]);
+            glm::vec3 d = glm::max(glm::max(low - s.center, s.center - high), glm::vec3(0.0f));
+            if (glm::dot(d, d) <= s.radius * s.radius)
+                mask |= 1u << lane;
+        }
+        return mask;
+    }
+
+    unsigned int coneMask(size_t i, const Cone &cone) const
+    {
+        unsigned int mask = 0;
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            size_t c = i + lane;
+            glm::vec3 v = glm::vec3(bounds.centerX[c], bounds.centerY[c], bounds.centerZ[c]) - cone.tip;
+            float radius = bounds.radius[c];
+            float along = glm::dot(v, cone.direction);
+            float across = std::sqrt(std::max(glm::dot(v, v) - along * along, 0.0f));
+            float outside = across * cone.cosAngle - along * cone.sinAngle;
+            if (!(outside > radius || along > radius + cone.range || along < -radius))
+                mask |= 1u << lane;
+        }
+        return mask;
+    }
+#endif
+
+    // runs work(0 .. count - 1) on the pool and on this thread, returns when all are done. The pool may be busy with
+    // long loads, so this thread takes whatever the workers have not started. Helpers of earlier frames still waiting
+    // in the queue count against the ones enqueued now, so a backlogged pool does not pile up more of them in front
+    // of its loads.
+    void parallelFor(int count, std::function<void(int)> work)
+    {
+        struct Job {
+            std::function<void(int)> work;
+            int count;
+            std::atomic<int> next;
+            std::atomic<int> done;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->work = std::move(work);
+        job->count = count;
+        job->next = 0;
+        job->done = 0;
+        std::function<void()> run = [job]() {
+            for (int i; (i = job->next++) < job->count;)
+            {
+                job->work(i);
+                if (++job->done == job->count)
+                {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    job->finished.notify_all();
+                }
+            }
+        };
+        std::shared_ptr<std::atomic<int>> pending = pendingHelpers;
+        std::function<void()> help = [pending, run]() {
+            (*pending)--;
+            run();
+        };
+        int helpers = std::min((int)pool.Size() - *pending, count - 1);
+        for (int i = 0; i < helpers; i++)
+        {
+            (*pending)++;
+            pool.Enqueue(help);
+        }
+        run();
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&job]() { return job->done == job->count; });
+    }
+
+    void upload()
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, grid.size() * sizeof(uint32_t), grid.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+        if (indices.size() > indexCapacity || indexCapacity == 0)
+        {
+            indexCapacity = std::max(std::max(indices.size(), indexCapacity * 2), (size_t)1024);
+            glBufferData(GL_TEXTURE_BUFFER, indexCapacity * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+        }
+        if (!indices.empty())
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[0]);
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHTS_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[1]);
+        glActiveTexture(GL_TEXTURE0);
+    }
+};
+
+#endif
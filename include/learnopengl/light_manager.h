@@ -0,0 +1,233 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/uniform_buffer.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// a light is left out where it adds less than this to any color channel
+const float LIGHT_INFLUENCE_THRESHOLD = 1.0f / 256.0f;
+
+// texture unit the packed lights are bound to, above the ones the materials use
+const int LIGHT_DATA_TEXTURE_UNIT = 15;
+
+// texels (RGBA32F) per light in the light buffer, see LightManager
+const int POINT_LIGHT_TEXELS = 4;
+const int SPOT_LIGHT_TEXELS = 6;
+
+struct PointLight {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    glm::vec3 cubeColor; // of the cube drawn where the light is, only seen in the scene
+};
+
+struct SpotLight {
+    glm::vec3 position;
+    glm::vec3 direction;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+    float cutOff;      // cosines of the inner and outer cone angles
+    float outerCutOff;
+};
+
+// The lights of the scene, any number of each kind. Upload packs them once per frame into a texture buffer that the
+// lighting shader reads with texelFetch from the sampler "lightData" (bound to LIGHT_DATA_TEXTURE_UNIT), and writes
+// their counts into the Lights uniform block. Every light gets an influence radius from its attenuation, the distance
+// past which it adds less than LIGHT_INFLUENCE_THRESHOLD, and the shader skips it beyond that.
+//
+// Buffer layout, the point lights first and the spot lights after them:
+//   point: [position, radius] [ambient, constant] [diffuse, linear] [specular, quadratic]
+//   spot:  [position, radius] [direction, cutOff] [ambient, constant] [diffuse, linear] [specular, quadratic]
+//          [outerCutOff, 0, 0, 0]
+class LightManager
+{
+public:
+    std::vector<PointLight> pointLights;
+    std::vector<SpotLight> spotLights;
+
+    // registers the Lights block, create it before the shaders that light with it
+    LightManager() : countsBuffer("Lights", LIGHTS_UNIFORM_BINDING), capacity(0)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    ~LightManager()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    LightManager(const LightManager &) = delete;
+    LightManager &operator=(const LightManager &) = delete;
+
+    // replaces the lights with the ones listed in filename, one per line (angles in degrees, # starts a comment):
+    //   point  position  ambient  diffuse  specular  constant linear quadratic
+    //   spot   position  direction  ambient  diffuse  specular  constant linear quadratic  cutOff outerCutOff
+    bool LoadFromFile(const std::string &filename)
+    {
+        std::ifstream in(filename);
+        if (!in)
+        {
+            std::cout << "ERROR::LIGHT_MANAGER:: cannot open " << filename << std::endl;
+            return false;
+        }
+        std::vector<PointLight> points;
+        std::vector<SpotLight> spots;
+        std::string line;
+        for (int number = 1; std::getline(in, line); number++)
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind))
+                continue;
+            bool read = false;
+            if (kind == "point")
+            {
+                PointLight light;
+                read = readVec3(fields, light.position) && readVec3(fields, light.ambient) && readVec3(fields, light.diffuse) &&
+                       readVec3(fields, light.specular) && fields >> light.constant >> light.linear >> light.quadratic &&
+                       readVec3(fields, light.cubeColor);
+                points.push_back(light);
+            }
+            else if (kind == "spot")
+            {
+                SpotLight light;
+                float cutOff = 0.0f, outerCutOff = 0.0f;
+                read = readVec3(fields, light.position) && readVec3(fields, light.direction) && readVec3(fields, light.ambient) &&
+                       readVec3(fields, light.diffuse) && readVec3(fields, light.specular) &&
+                       fields >> light.constant >> light.linear >> light.quadratic >> cutOff >> outerCutOff;
+                light.cutOff = glm::cos(glm::radians(cutOff));
+                light.outerCutOff = glm::cos(glm::radians(outerCutOff));
+                spots.push_back(light);
+            }
+            if (!read)
+            {
+                std::cout << "ERROR::LIGHT_MANAGER:: " << filename << ":" << number << ": cannot read light" << std::endl;
+                return false;
+            }
+        }
+        pointLights.swap(points);
+        spotLights.swap(spots);
+        return true;
+    }
+
+    // distance from a light with this attenuation and brightest channel past which it adds less than
+    // LIGHT_INFLUENCE_THRESHOLD, FLT_MAX when it never fades that far
+    static float InfluenceRadius(float constant, float linear, float quadratic, float intensity)
+    {
+        // intensity / (constant + linear * d + quadratic * d^2) = threshold
+        float c = constant - intensity / LIGHT_INFLUENCE_THRESHOLD;
+        if (c >= 0.0f)
+            return 0.0f;
+        if (quadratic > 0.0f)
+            return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+        if (linear > 0.0f)
+            return -c / linear;
+        return FLT_MAX;
+    }
+
+    static float InfluenceRadius(const PointLight &light)
+    {
+        return InfluenceRadius(light.constant, light.linear, light.quadratic, brightest(light.ambient + light.diffuse + light.specular));
+    }
+
+    static float InfluenceRadius(const SpotLight &light)
+    {
+        return InfluenceRadius(light.constant, light.linear, light.quadratic, brightest(light.ambient + light.diffuse + light.specular));
+    }
+
+    // packs the lights into the light buffer and binds it for drawing. Once per frame on the GL thread, before the
+    // lit objects are drawn.
+    void Upload()
+    {
+        std::vector<glm::vec4> &texels = staging;
+        texels.clear();
+        for (const PointLight &light : pointLights)
+        {
+            texels.push_back(glm::vec4(light.position, InfluenceRadius(light)));
+            texels.push_back(glm::vec4(light.ambient, light.constant));
+            texels.push_back(glm::vec4(light.diffuse, light.linear));
+            texels.push_back(glm::vec4(light.specular, light.quadratic));
+        }
+        for (const SpotLight &light : spotLights)
+        {
+            texels.push_back(glm::vec4(light.position, InfluenceRadius(light)));
+            texels.push_back(glm::vec4(light.direction, light.cutOff));
+            texels.push_back(glm::vec4(light.ambient, light.constant));
+            texels.push_back(glm::vec4(light.diffuse, light.linear));
+            texels.push_back(glm::vec4(light.specular, light.quadratic));
+            texels.push_back(glm::vec4(light.outerCutOff, 0.0f, 0.0f, 0.0f));
+        }
+
+        LightUniforms counts;
+        counts.pointLightCount = (int)pointLights.size();
+        counts.spotLightCount = (int)spotLights.size();
+        countsBuffer.Update(counts);
+
+        // the lights rarely change from one frame to the next
+        if (texels != uploaded)
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            if (texels.size() > capacity)
+            {
+                capacity = std::max(texels.size(), capacity * 2);
+                glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+            }
+            if (!texels.empty())
+                glBufferSubData(GL_TEXTURE_BUFFER, 0, texels.size() * sizeof(glm::vec4), texels.data());
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            uploaded.swap(staging);
+        }
+
+        glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    UniformBuffer<LightUniforms> countsBuffer;
+    unsigned int buffer, texture;
+    size_t capacity; // in texels
+    std::vector<glm::vec4> uploaded, staging;
+
+    static float brightest(const glm::vec3 &color)
+    {
+        return std::max(color.r, std::max(color.g, color.b));
+    }
+
+    static bool readVec3(std::istream &in, glm::vec3 &value)
+    {
+        return (bool)(in >> value.x >> value.y >> value.z);
+    }
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// resident set size of the process, now and at its highest so far, in bytes (0 where /proc is not available)
+struct MemoryUsage {
+    size_t resident = 0;
+    size_t peak = 0;
+};
+
+inline MemoryUsage ReadMemoryUsage()
+{
+    MemoryUsage usage;
+    FILE *status = std::fopen("/proc/self/status", "r");
+    if (!status)
+        return usage;
+    char line[256];
+    while (std::fgets(line, sizeof(line), status))
+    {
+        unsigned long kilobytes;
+        if (std::sscanf(line, "VmRSS: %lu kB", &kilobytes) == 1)
+            usage.resident = (size_t)kilobytes * 1024;
+        else if (std::sscanf(line, "VmHWM: %lu kB", &kilobytes) == 1)
+            usage.peak = (size_t)kilobytes * 1024;
+    }
+    std::fclose(status);
+    return usage;
+}
+
+#endif
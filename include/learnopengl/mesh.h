@@ -6,9 +6,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/arena.h>
+#include <learnopengl/geometry_heap.h>
+#include <learnopengl/meshlet.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_format.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -25,6 +33,75 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// bounds of the positions and texture coordinates of vertices, grown span by span, that the compact format is
+// quantized against
+struct VertexBounds {
+    glm::vec3 low = glm::vec3(FLT_MAX), high = glm::vec3(-FLT_MAX);
+    glm::vec2 lowUV = glm::vec2(FLT_MAX), highUV = glm::vec2(-FLT_MAX);
+
+    void Add(const Vertex *vertices, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            low = glm::min(low, vertices[i].Position);
+            high = glm::max(high, vertices[i].Position);
+            lowUV = glm::min(lowUV, vertices[i].TexCoords);
+            highUV = glm::max(highUV, vertices[i].TexCoords);
+        }
+    }
+
+    // how to decode vertices encoded against these bounds, identity while empty
+    VertexDecode Decode() const
+    {
+        VertexDecode decode;
+        if (low.x > high.x)
+            return decode;
+        glm::vec3 center = (low + high) * 0.5f, extent = (high - low) * 0.5f;
+        glm::vec2 spanUV = highUV - lowUV;
+        decode.position[0][0] = extent.x;
+        decode.position[1][1] = extent.y;
+        decode.position[2][2] = extent.z;
+        decode.position[3] = glm::vec4(center, 1.0f);
+        decode.texCoords = glm::vec4(spanUV.x, spanUV.y, lowUV.x, lowUV.y);
+        return decode;
+    }
+};
+
+// encodes vertices into the compact format against the bounds decode was made from
+inline void EncodeCompactVertices(const Vertex *vertices, size_t count, const VertexDecode &decode, CompactVertex *out)
+{
+    glm::vec3 center(decode.position[3]);
+    glm::vec3 extent(decode.position[0][0], decode.position[1][1], decode.position[2][2]);
+    glm::vec2 lowUV(decode.texCoords.z, decode.texCoords.w), spanUV(decode.texCoords.x, decode.texCoords.y);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &vertex = vertices[i];
+        CompactVertex &compact = out[i];
+        for (int c = 0; c < 3; c++)
+            compact.position[c] = extent[c] > 0.0f ? PackSnorm16((vertex.Position[c] - center[c]) / extent[c]) : 0;
+        compact.position[3] = 32767;
+        glm::vec2 normal = OctahedralEncode(vertex.Normal);
+        compact.normal[0] = PackSnorm16(normal.x);
+        compact.normal[1] = PackSnorm16(normal.y);
+        for (int c = 0; c < 2; c++)
+            compact.texCoords[c] = spanUV[c] > 0.0f ? PackUnorm16((vertex.TexCoords[c] - lowUV[c]) / spanUV[c]) : 0;
+        glm::vec4 frame = TangentFrameQuaternion(vertex.Normal, vertex.Tangent, vertex.Bitangent);
+        for (int c = 0; c < 4; c++)
+            compact.tangentFrame[c] = PackSnorm8(frame[c]);
+    }
+}
+
+// encodes vertices into the compact format, returns how to decode them
+inline VertexDecode EncodeCompactVertices(const Vertex *vertices, size_t count, std::vector<CompactVertex> &out)
+{
+    VertexBounds bounds;
+    bounds.Add(vertices, count);
+    VertexDecode decode = bounds.Decode();
+    out.resize(count);
+    EncodeCompactVertices(vertices, count, decode, out.data());
+    return decode;
+}
+
 
 
 struct Texture {
@@ -33,37 +110,350 @@ struct Texture {
     string path;
 };
 
+// a level of detail shows while its error projects to fewer pixels than this
+const float MESH_LOD_PIXEL_ERROR = 1.0f;
+// a coarser level is only taken once its error is this much below the limit, so a camera sitting at the threshold
+// does not make the level flicker back and forth
+const float MESH_LOD_HYSTERESIS = 0.75f;
+
+// one level of detail, a range of the mesh's index buffer (see BuildLods in mesh_simplifier.h)
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error; // how far the level strays from the full mesh, in model units
+};
+
+// CPU side result of importing a mesh. Filled on a loader thread, turned into a Mesh on the GL thread. Vertices and
+// indices live in the importing model's arena (on the heap without one) and are gone once the model is uploaded.
+struct MeshData {
+    explicit MeshData(Arena *arena = nullptr)
+        : vertices(ArenaAllocator<Vertex>(arena)), indices(ArenaAllocator<unsigned int>(arena))
+    {
+    }
+
+    ArenaVector<Vertex>       vertices;
+    ArenaVector<unsigned int> indices;
+    vector<pair<string, string>> textures; // (type, path) as returned by the material
+    vector<Meshlet>      meshlets; // only for large meshes, see BuildMeshlets
+    vector<MeshLod>      lods;     // empty, or the full mesh first and then coarser levels appended to indices
+};
+
+// geometry heap formats (see GeometryHeap) of the two vertex layouts
+const unsigned int MESH_VERTEX_FORMAT = 1;
+const unsigned int MESH_COMPACT_VERTEX_FORMAT = 2;
+
+// where a mesh sits in the ranges of a static batch (see Model::staticBatch), which hold the vertices and indices of
+// all the meshes of a model
+struct MeshBatchSlot {
+    const GeometryRange *vertices;
+    const GeometryRange *indices;
+    GLenum indexType;
+    bool compact;
+    VertexDecode decode;     // one for the whole batch
+    unsigned int firstIndex; // of the mesh's indices in the batch's index range
+    int baseVertex;          // added to the mesh's indices, where its vertices start in the batch's vertex range
+};
+
+// The vertices and indices live in ranges of the GeometryHeap, a standalone mesh owns its ranges and a batched one
+// points into its model's. A copy would share the ranges and the CPU data with the original, meshes are only moved.
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, vertices and indices stay empty unless the mesh was built to keep them (see keepCpuData)
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    vector<Meshlet>      meshlets;
+    vector<MeshLod>      lods;
 
-    unsigned int VAO;
+    unsigned int VAO;            // the heap's VAO of the vertex format, shared with every mesh of that format
+    unsigned int indexCount;
+    unsigned int firstIndex = 0; // where the mesh's indices start in its index range, only non zero in a static batch
+    int baseVertex = 0;          // same for the vertices
+    GLenum indexType;        // GL_UNSIGNED_SHORT for meshes with up to 65536 vertices
+    bool compact;            // vertices are CompactVertex (vertex_format.h) instead of Vertex
+    VertexDecode decode;
+    // bounding sphere in model space, and the larger of the U and V ranges the texture coordinates cover
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    float texCoordSpan;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes over the vectors and keeps them. compactVertices uploads the vertices in the compact format
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool compactVertices = false)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), compact(compactVertices)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // constructs the mesh from storage it does not own (a mapped mesh cache, an import arena). The data is only read
+    // during the upload, the mesh keeps a CPU copy of its vertices and indices only with keepCpuData, for code that
+    // needs the geometry after upload (picking, physics).
+    Mesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount, vector<Texture> textures,
+         bool compactVertices = false, bool keepCpuData = false)
+        : textures(std::move(textures)), compact(compactVertices)
+    {
+        if (keepCpuData)
+        {
+            this->vertices.assign(vertices, vertices + vertexCount);
+            this->indices.assign(indices, indices + indexCount);
+        }
+        setupMesh(vertices, vertexCount, indices, indexCount);
+    }
+
+    // a mesh whose vertices and indices were uploaded by its model into a static batch, it only keeps where they are.
+    // keepCpuData as above.
+    Mesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount, vector<Texture> textures,
+         const MeshBatchSlot &slot, bool keepCpuData = false)
+        : textures(std::move(textures)), indexCount(indexCount), firstIndex(slot.firstIndex), baseVertex(slot.baseVertex),
+          indexType(slot.indexType), compact(slot.compact), decode(slot.decode), vertexRange(slot.vertices), indexRange(slot.indices)
+    {
+        VAO = GeometryHeap::Instance().VertexArray(vertexRange->pool);
+        if (keepCpuData)
+        {
+            this->vertices.assign(vertices, vertices + vertexCount);
+            this->indices.assign(indices, indices + indexCount);
+        }
+        computeBounds(vertices, vertexCount);
     }
 
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
+
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropriate textures
+        BindMaterial(shader);
+
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, FullIndexCount(), indexType, indexPointer(0), BaseVertex());
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // render the parts of the mesh inside the view: meshlets outside the frustum or facing away are skipped, meshes
+    // without meshlets are culled as a whole against the frustum. Away from the camera a coarser level of detail is
+    // drawn whole instead; instance tells the drawn copies of a mesh apart, each switches levels on its own.
+    void Draw(Shader &shader, const CullView &cullView, CullStats &stats, unsigned int instance = 0)
+    {
+        drawCounts.clear();
+        drawOffsets.clear();
+        CollectDraws(cullView, stats, instance, drawCounts, drawOffsets);
+        if (drawCounts.empty())
+            return;
+        drawBaseVertices.assign(drawCounts.size(), BaseVertex());
+
+        BindMaterial(shader);
+        glBindVertexArray(VAO);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        stats.drawCalls++;
+    }
+
+    // appends the index ranges Draw would draw for this view (counts, and offsets into the index buffer), without
+    // drawing them. The ranges are drawn with BaseVertex().
+    void CollectDraws(const CullView &cullView, CullStats &stats, unsigned int instance, vector<GLsizei> &counts, vector<const void *> &offsets)
+    {
+        unsigned int triangles = FullIndexCount() / 3;
+        stats.triangles += triangles;
+        if (!SphereInFrustum(cullView, boundsCenter, boundsRadius))
+        {
+            stats.trianglesCulledFrustum += triangles;
+            stats.meshlets += meshlets.size();
+            stats.meshletsCulled += meshlets.size();
+            return;
+        }
+        unsigned int level = selectLod(cullView, instance);
+        if (level > 0)
+        {
+            stats.trianglesSkippedLod += triangles - lods[level].indexCount / 3;
+            counts.push_back(lods[level].indexCount);
+            offsets.push_back(indexPointer(lods[level].indexOffset));
+            return;
+        }
+        if (meshlets.empty())
+        {
+            counts.push_back(FullIndexCount());
+            offsets.push_back(indexPointer(0));
+            return;
+        }
+
+        // visible meshlets, neighbours in the index buffer merged into one range
+        size_t first = counts.size();
+        uint32_t rangeEnd = ~0u;
+        for (const Meshlet &meshlet : meshlets)
+        {
+            stats.meshlets++;
+            if (!SphereInFrustum(cullView, meshlet.center, meshlet.radius))
+            {
+                stats.meshletsCulled++;
+                stats.trianglesCulledFrustum += meshlet.indexCount / 3;
+                continue;
+            }
+            if (MeshletBackfacing(cullView, meshlet))
+            {
+                stats.meshletsCulled++;
+                stats.trianglesCulledBackface += meshlet.indexCount / 3;
+                continue;
+            }
+            if (meshlet.indexOffset == rangeEnd && counts.size() > first)
+            {
+                counts.back() += meshlet.indexCount;
+            }
+            else
+            {
+                counts.push_back(meshlet.indexCount);
+                offsets.push_back(indexPointer(meshlet.indexOffset));
+            }
+            rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+        }
+    }
+
+    // indices of the full detail mesh, the levels of detail follow them
+    unsigned int FullIndexCount() const
+    {
+        return lods.empty() ? indexCount : lods[0].indexCount;
+    }
+
+    // where the mesh's first index and vertex are in the heap's buffers right now. Defragmenting the heap moves them,
+    // so they are looked up for every draw instead of being kept.
+    unsigned int FirstIndex() const
+    {
+        return indexRange->offset / indexSize() + firstIndex;
+    }
+
+    int BaseVertex() const
+    {
+        return vertexRange->offset + baseVertex;
+    }
+
+    // binds the textures and sets the vertex format uniforms
+    void BindMaterial(Shader &shader)
+    {
+        if (&shader != materialShader || glslIdentifierPrefix != materialPrefix)
+            resolveMaterialUniforms(shader);
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.Set(samplerUniforms[i], (int)i);
+            // and finally bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+
+        // how to read the vertex format, shaders without these uniforms ignore them
+        shader.Set(positionDecodeUniform, decode.position);
+        shader.Set(texCoordDecodeUniform, decode.texCoords);
+        shader.Set(compactUniform, (int)compact);
+    }
+
+    // the attribute layout of either vertex format, for the bound VAO and vertex buffer
+    static void SetVertexAttributes(bool compact)
+    {
+        if (compact)
+        {
+            // positions, w is 1
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
+            // octahedral normals
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+            // texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, texCoords));
+            // tangent frame quaternion, the bitangent is rebuilt from it
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, tangentFrame));
+        }
+        else
+        {
+            // set the vertex attribute pointers
+            // vertex Positions
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+            // vertex normals
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+            // vertex texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+            // vertex tangent
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+            // vertex bitangent
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        }
+    }
+
+    // puts vertices into the heap, encoded into the compact format when compact (decode then says how to read them)
+    static GeometryAllocation AllocateVertices(const Vertex *vertexData, size_t count, bool compact, VertexDecode &decode)
+    {
+        if (compact)
+        {
+            vector<CompactVertex> encoded;
+            decode = EncodeCompactVertices(vertexData, count, encoded);
+            return AllocateVertexData(encoded.data(), count, true);
+        }
+        decode = VertexDecode();
+        // A great thing about structs is that their memory layout is sequential for all its items.
+        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+        // again translates to 3/2 floats which translates to a byte array.
+        return AllocateVertexData(vertexData, count, false);
+    }
+
+    // puts vertices that already are in their format (CompactVertex when compact, else Vertex) into the heap. Null data
+    // only takes the range, to be filled with GeometryHeap::Write.
+    static GeometryAllocation AllocateVertexData(const void *vertexData, size_t count, bool compact)
+    {
+        GeometryHeap &heap = GeometryHeap::Instance();
+        if (compact)
+            return heap.AllocateVertices(MESH_COMPACT_VERTEX_FORMAT, sizeof(CompactVertex), &setCompactAttributes, vertexData, count);
+        return heap.AllocateVertices(MESH_VERTEX_FORMAT, sizeof(Vertex), &setFullAttributes, vertexData, count);
+    }
+
+    // puts indices into the heap, in 16 bits when shortIndices, and returns the index type in type
+    static GeometryAllocation AllocateIndices(const unsigned int *indexData, size_t count, bool shortIndices, GLenum &type)
+    {
+        type = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        return GeometryHeap::Instance().AllocateIndices(indexData, count, type);
+    }
+
+private:
+    // render data, the ranges are owned by the allocations unless the mesh is part of a static batch
+    const GeometryRange *vertexRange = nullptr;
+    const GeometryRange *indexRange = nullptr;
+    GeometryAllocation vertexAllocation, indexAllocation;
+    // draw ranges of the last culled draw, kept to save the allocations
+    vector<GLsizei> drawCounts;
+    vector<const void *> drawOffsets;
+    vector<GLint> drawBaseVertices;
+    // level of detail each drawn instance showed last
+    vector<unsigned int> instanceLods;
+    // uniforms of the shader and prefix BindMaterial ran with last, resolved when either changes
+    const Shader *materialShader = nullptr;
+    string materialPrefix;
+    vector<UniformHandle<int>> samplerUniforms;
+    UniformHandle<glm::mat4> positionDecodeUniform;
+    UniformHandle<glm::vec4> texCoordDecodeUniform;
+    UniformHandle<int> compactUniform;
+
+    void resolveMaterialUniforms(const Shader &shader)
+    {
+        materialShader = &shader;
+        materialPrefix = glslIdentifierPrefix;
+        samplerUniforms.clear();
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -75,65 +465,86 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerUniforms.push_back(shader.Uniform<int>(glslIdentifierPrefix + name + number));
         }
+        positionDecodeUniform = shader.Uniform<glm::mat4>("vertexPositionDecode");
+        texCoordDecodeUniform = shader.Uniform<glm::vec4>("vertexTexCoordDecode");
+        compactUniform = shader.Uniform<int>("compactVertices");
+    }
 
+    // the coarsest level whose error stays under MESH_LOD_PIXEL_ERROR pixels, only coarsening with some margin
+    unsigned int selectLod(const CullView &cullView, unsigned int instance)
+    {
+        if (lods.empty())
+            return 0;
+        if (instance >= instanceLods.size())
+            instanceLods.resize(instance + 1, 0);
+        unsigned int &level = instanceLods[instance];
+        float distance = glm::length(boundsCenter - cullView.eye) - boundsRadius;
+        if (distance <= 0.0f)
+            return level = 0;
+        float pixelsPerError = cullView.pixelsPerUnit / distance;
+        while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerError <= MESH_LOD_PIXEL_ERROR * MESH_LOD_HYSTERESIS)
+            level++;
+        while (level > 0 && lods[level].error * pixelsPerError > MESH_LOD_PIXEL_ERROR)
+            level--;
+        return level;
+    }
 
+    // puts the vertices and indices into the geometry heap
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t count)
+    {
+        indexCount = count;
+        computeBounds(vertexData, vertexCount);
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        vertexAllocation = AllocateVertices(vertexData, vertexCount, compact, decode);
+        // 16 bit indices whenever they fit
+        indexAllocation = AllocateIndices(indexData, count, vertexCount <= 65536, indexType);
+        vertexRange = vertexAllocation.Range();
+        indexRange = indexAllocation.Range();
+        VAO = GeometryHeap::Instance().VertexArray(vertexRange->pool);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    static void setFullAttributes()
+    {
+        SetVertexAttributes(false);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    static void setCompactAttributes()
+    {
+        SetVertexAttributes(true);
+    }
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    size_t indexSize() const
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    }
 
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    // byte offset of one of the mesh's indices in the index buffer
+    const void *indexPointer(uint32_t index) const
+    {
+        return (const void *)((size_t)(FirstIndex() + index) * indexSize());
+    }
 
-        glBindVertexArray(0);
+    void computeBounds(const Vertex *vertexData, size_t vertexCount)
+    {
+        boundsCenter = glm::vec3(0.0f);
+        boundsRadius = 0.0f;
+        texCoordSpan = 0.0f;
+        if (vertexCount == 0)
+            return;
+        glm::vec3 low = vertexData[0].Position, high = vertexData[0].Position;
+        glm::vec2 lowUV = vertexData[0].TexCoords, highUV = vertexData[0].TexCoords;
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            low = glm::min(low, vertexData[i].Position);
+            high = glm::max(high, vertexData[i].Position);
+            lowUV = glm::min(lowUV, vertexData[i].TexCoords);
+            highUV = glm::max(highUV, vertexData[i].TexCoords);
+        }
+        boundsCenter = (low + high) * 0.5f;
+        boundsRadius = glm::length(high - low) * 0.5f;
+        texCoordSpan = std::max(highUV.x - lowUV.x, highUV.y - lowUV.y);
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,282 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Binary cache of an imported model, stored next to the source as "<model>.meshcache".
+// Layout (all little endian, every section 4 byte aligned):
+//   MeshCacheHeader
+//   per mesh: MeshCacheEntry, texture references, Vertex[vertexCount], unsigned int[indexCount], Meshlet[meshletCount], MeshLod[lodCount]
+//   MeshCacheBatch, CompactVertex[vertexCount], uint16_t[indexCount] (both counts 0 unless the model is a static batch)
+// The cache is keyed by a hash of the source file (and the .mtl files it references) plus the
+// Assimp import flags, so changing either makes the model go through Assimp again.
+const uint32_t MESH_CACHE_MAGIC   = 0x434d4752; // "RGMC"
+const uint32_t MESH_CACHE_VERSION = 6; // 2: meshes are stored optimized (mesh_optimizer.h), 3: and welded, 4: meshlets, 5: LOD chains,
+                                       // 6: static batches in their upload layout
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t meshCount;
+    uint64_t sourceHash;
+};
+
+struct MeshCacheEntry {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t meshletCount;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+struct MeshCacheBatch {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    VertexDecode decode;
+};
+
+// a mesh as it sits in the mapped cache file, vertices and indices point straight into the mapping
+struct CachedMesh {
+    const Vertex       *vertices;
+    unsigned int        vertexCount;
+    const unsigned int *indices;
+    unsigned int        indexCount;
+    const Meshlet      *meshlets;
+    unsigned int        meshletCount;
+    const MeshLod      *lods;
+    unsigned int        lodCount;
+    vector<pair<string, string>> textures; // (type, path) as returned by the material
+};
+
+// a static batch (see Model::staticBatch) in the layout it is uploaded in: the vertices of all its meshes in the compact
+// format, quantized against the bounds of the whole batch, and their indices narrowed to 16 bits. Either is null when
+// the batch keeps the meshes' own vertices or 32 bit indices, the meshes are then uploaded one after the other.
+struct CachedBatch {
+    const CompactVertex *vertices = nullptr;
+    unsigned int         vertexCount = 0;
+    const uint16_t      *indices = nullptr;
+    unsigned int         indexCount = 0;
+    VertexDecode         decode;
+};
+
+class MeshCache
+{
+public:
+    vector<CachedMesh> meshes;
+    CachedBatch batch;
+
+    static string PathFor(const string &modelPath)
+    {
+        return modelPath + ".meshcache";
+    }
+
+    // hashes the model file and, for Wavefront files, every material library it pulls in
+    static uint64_t SourceHash(const string &modelPath)
+    {
+        MappedFile source(modelPath);
+        if (!source.isOpen())
+            return 0;
+        uint64_t hash = HashBytes(source.data, source.size);
+
+        string directory = modelPath.substr(0, modelPath.find_last_of('/'));
+        const char *text = (const char *)source.data;
+        const char *end = text + source.size;
+        const char *line = text;
+        while (line < end)
+        {
+            const char *eol = (const char *)memchr(line, '\n', end - line);
+            if (!eol)
+                eol = end;
+            if (eol - line > 7 && strncmp(line, "mtllib ", 7) == 0)
+            {
+                string name(line + 7, eol);
+                while (!name.empty() && (name.back() == '\r' || name.back() == ' '))
+                    name.pop_back();
+                MappedFile library(directory + '/' + name);
+                if (library.isOpen())
+                    hash = HashBytes(library.data, library.size, hash);
+            }
+            line = eol + 1;
+        }
+        return hash;
+    }
+
+    // maps the cache file and validates it against the expected key. On success meshes points into the mapping,
+    // which stays alive until this object is destroyed.
+    bool Load(const string &cachePath, uint64_t sourceHash, unsigned int importFlags)
+    {
+        meshes.clear();
+        if (!file.open(cachePath) || file.size < sizeof(MeshCacheHeader))
+            return false;
+
+        const MeshCacheHeader *header = (const MeshCacheHeader *)file.data;
+        if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION ||
+            header->importFlags != importFlags || header->sourceHash != sourceHash)
+            return fail();
+
+        size_t offset = sizeof(MeshCacheHeader);
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            if (!fits(offset, sizeof(MeshCacheEntry)))
+                return fail();
+            const MeshCacheEntry *entry = (const MeshCacheEntry *)(file.data + offset);
+            offset += sizeof(MeshCacheEntry);
+
+            CachedMesh mesh;
+            for (uint32_t t = 0; t < entry->textureCount; t++)
+            {
+                if (!fits(offset, 2 * sizeof(uint32_t)))
+                    return fail();
+                const uint32_t *lengths = (const uint32_t *)(file.data + offset);
+                offset += 2 * sizeof(uint32_t);
+                size_t stringBytes = align4((size_t)lengths[0] + lengths[1]);
+                if (!fits(offset, stringBytes))
+                    return fail();
+                const char *chars = (const char *)(file.data + offset);
+                mesh.textures.push_back(make_pair(string(chars, lengths[0]), string(chars + lengths[0], lengths[1])));
+                offset += stringBytes;
+            }
+
+            size_t vertexBytes = (size_t)entry->vertexCount * sizeof(Vertex);
+            size_t indexBytes = (size_t)entry->indexCount * sizeof(unsigned int);
+            size_t meshletBytes = (size_t)entry->meshletCount * sizeof(Meshlet);
+            size_t lodBytes = (size_t)entry->lodCount * sizeof(MeshLod);
+            if (!fits(offset, vertexBytes + indexBytes + meshletBytes + lodBytes))
+                return fail();
+            mesh.vertices = (const Vertex *)(file.data + offset);
+            mesh.vertexCount = entry->vertexCount;
+            offset += vertexBytes;
+            mesh.indices = (const unsigned int *)(file.data + offset);
+            mesh.indexCount = entry->indexCount;
+            offset += indexBytes;
+            mesh.meshlets = (const Meshlet *)(file.data + offset);
+            mesh.meshletCount = entry->meshletCount;
+            offset += meshletBytes;
+            mesh.lods = (const MeshLod *)(file.data + offset);
+            mesh.lodCount = entry->lodCount;
+            offset += lodBytes;
+            meshes.push_back(mesh);
+        }
+
+        if (!fits(offset, sizeof(MeshCacheBatch)))
+            return fail();
+        const MeshCacheBatch *stored = (const MeshCacheBatch *)(file.data + offset);
+        offset += sizeof(MeshCacheBatch);
+        size_t vertexBytes = (size_t)stored->vertexCount * sizeof(CompactVertex);
+        if (!fits(offset, vertexBytes + align4((size_t)stored->indexCount * sizeof(uint16_t))))
+            return fail();
+        batch = CachedBatch();
+        batch.vertexCount = stored->vertexCount;
+        batch.indexCount = stored->indexCount;
+        batch.decode = stored->decode;
+        if (stored->vertexCount > 0)
+            batch.vertices = (const CompactVertex *)(file.data + offset);
+        if (stored->indexCount > 0)
+            batch.indices = (const uint16_t *)(file.data + offset + vertexBytes);
+        return true;
+    }
+
+    // drops the mapping once the meshes have been uploaded
+    void Release()
+    {
+        meshes.clear();
+        batch = CachedBatch();
+        file.close();
+    }
+
+    // writes the cache next to the model. Written to a temporary file first so a crash never leaves a torn cache behind.
+    static bool Store(const string &cachePath, uint64_t sourceHash, unsigned int importFlags, const vector<MeshData> &meshes,
+                      const CachedBatch &batch = CachedBatch())
+    {
+        string tempPath = cachePath + ".tmp";
+        ofstream out(tempPath, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+
+        MeshCacheHeader header;
+        header.magic = MESH_CACHE_MAGIC;
+        header.version = MESH_CACHE_VERSION;
+        header.importFlags = importFlags;
+        header.meshCount = (uint32_t)meshes.size();
+        header.sourceHash = sourceHash;
+        out.write((const char *)&header, sizeof(header));
+
+        static const char padding[4] = {0, 0, 0, 0};
+        for (const MeshData &mesh : meshes)
+        {
+            MeshCacheEntry entry;
+            entry.vertexCount = (uint32_t)mesh.vertices.size();
+            entry.indexCount = (uint32_t)mesh.indices.size();
+            entry.textureCount = (uint32_t)mesh.textures.size();
+            entry.meshletCount = (uint32_t)mesh.meshlets.size();
+            entry.lodCount = (uint32_t)mesh.lods.size();
+            entry.reserved = 0;
+            out.write((const char *)&entry, sizeof(entry));
+
+            for (const pair<string, string> &texture : mesh.textures)
+            {
+                uint32_t lengths[2] = {(uint32_t)texture.first.size(), (uint32_t)texture.second.size()};
+                out.write((const char *)lengths, sizeof(lengths));
+                out.write(texture.first.data(), lengths[0]);
+                out.write(texture.second.data(), lengths[1]);
+                size_t written = (size_t)lengths[0] + lengths[1];
+                out.write(padding, align4(written) - written);
+            }
+
+            out.write((const char *)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            out.write((const char *)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            out.write((const char *)mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+            out.write((const char *)mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+        }
+
+        MeshCacheBatch stored;
+        stored.vertexCount = batch.vertices ? batch.vertexCount : 0;
+        stored.indexCount = batch.indices ? batch.indexCount : 0;
+        stored.decode = batch.decode;
+        out.write((const char *)&stored, sizeof(stored));
+        out.write((const char *)batch.vertices, stored.vertexCount * sizeof(CompactVertex));
+        size_t indexBytes = stored.indexCount * sizeof(uint16_t);
+        out.write((const char *)batch.indices, indexBytes);
+        out.write(padding, align4(indexBytes) - indexBytes);
+        out.close();
+        if (!out)
+        {
+            remove(tempPath.c_str());
+            return false;
+        }
+        return rename(tempPath.c_str(), cachePath.c_str()) == 0;
+    }
+
+private:
+    MappedFile file;
+
+    static size_t align4(size_t size)
+    {
+        return (size + 3) & ~(size_t)3;
+    }
+
+    bool fits(size_t offset, size_t bytes) const
+    {
+        return offset <= file.size && bytes <= file.size - offset;
+    }
+
+    bool fail()
+    {
+        Release();
+        return false;
+    }
+};
+
+#endif
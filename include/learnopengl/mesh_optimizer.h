@@ -0,0 +1,604 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <learnopengl/arena.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/meshlet.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Import time optimization of indexed triangle meshes, run on the loader threads before a mesh is cached:
+//  0. identical vertices are welded (WeldVertices), the importer hands out one vertex per face corner,
+//  1. triangles are reordered for the post-transform vertex cache (Tom Forsyth's linear speed algorithm),
+//  2. runs of triangles that start with a cold cache are sorted so outward facing ones come first, a view
+//     independent overdraw heuristic (Sander et al.) that leaves the cache efficiency almost untouched,
+//  3. vertices are renumbered in the order the triangles first use them, for fetch locality,
+//  4. large meshes are split into meshlets for culling (BuildMeshlets, see meshlet.h).
+// Meshes that are not plain triangle lists are left alone.
+
+// FIFO cache size the statistics are measured with, about what current GPUs behave like
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    float acmr = 0.0f; // average cache miss ratio, vertex shader runs per triangle (0.5 to 3)
+    float atvr = 0.0f; // average transformed vertex ratio, vertex shader runs per used vertex (1 is ideal)
+};
+
+inline VertexCacheStats AnalyzeVertexCache(const ArenaVector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertexCount == 0)
+        return stats;
+    // the time a vertex entered the FIFO, it is still in there while less than cacheSize misses happened since
+    std::vector<size_t> enteredAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, usedCount = 0;
+    for (unsigned int index : indices)
+    {
+        if (!used[index])
+        {
+            used[index] = true;
+            usedCount++;
+        }
+        if (enteredAt[index] == 0 || misses - enteredAt[index] + 1 > cacheSize)
+        {
+            misses++;
+            enteredAt[index] = misses;
+        }
+    }
+    stats.acmr = (float)misses / (indices.size() / 3);
+    stats.atvr = (float)misses / usedCount;
+    return stats;
+}
+
+// welding
+// -------
+// vertices per hash bucket at most, so that the table of each bucket stays in cache
+const size_t WELD_BUCKET_VERTICES = 1 << 16;
+
+static_assert(sizeof(Vertex) == 14 * sizeof(float), "welding reads a Vertex as 14 floats");
+
+// a vertex attribute snapped to the weld grid (scale is 1 / epsilon), its exact bits with -0 as 0 when scale is 0
+inline int64_t WeldKey(float value, double scale)
+{
+    if (scale > 0.0)
+    {
+        double scaled = value * scale;
+        return (int64_t)(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+    }
+    if (value == 0.0f)
+        return 0;
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline uint64_t WeldHash(const Vertex &vertex, double scale)
+{
+    const float *values = (const float *)&vertex;
+    uint64_t hash = 0;
+    for (int i = 0; i < 14; i++)
+        hash = (hash ^ (uint64_t)WeldKey(values[i], scale)) * 0x100000001b3ull + 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+inline bool WeldEqual(const Vertex &a, const Vertex &b, double scale)
+{
+    const float *x = (const float *)&a, *y = (const float *)&b;
+    for (int i = 0; i < 14; i++)
+        if (WeldKey(x[i], scale) != WeldKey(y[i], scale))
+            return false;
+    return true;
+}
+
+// merges vertices whose position, normal, texture coordinates, tangent and bitangent all fall on the same
+// epsilon grid cell (0 welds only bitwise equal ones) and rewrites the indices. The first vertex of each group is
+// kept, in first appearance order. Runs on the calling thread, which is a loader worker already: large meshes are
+// split into buckets by hash in one pass and each bucket is welded on its own.
+inline void WeldVertices(ArenaVector<Vertex> &vertices, ArenaVector<unsigned int> &indices, float epsilon)
+{
+    size_t count = vertices.size();
+    if (count < 2)
+        return;
+    double scale = epsilon > 0.0f ? 1.0 / epsilon : 0.0;
+    size_t buckets = (count + WELD_BUCKET_VERTICES - 1) / WELD_BUCKET_VERTICES;
+
+    std::vector<uint64_t> hashes(count);
+    // the vertices of each bucket in increasing order, bucket b is order[bucketStart[b], bucketStart[b + 1])
+    std::vector<size_t> bucketStart(buckets + 1, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        hashes[i] = WeldHash(vertices[i], scale);
+        bucketStart[hashes[i] % buckets + 1]++;
+    }
+    for (size_t b = 0; b < buckets; b++)
+        bucketStart[b + 1] += bucketStart[b];
+    std::vector<unsigned int> order(count);
+    {
+        std::vector<size_t> next(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t i = 0; i < count; i++)
+            order[next[hashes[i] % buckets]++] = (unsigned int)i;
+    }
+
+    // representative[i] is the first vertex equal to i, never after it
+    std::vector<unsigned int> representative(count);
+    const unsigned int empty = ~0u;
+    std::vector<unsigned int> table;
+    for (size_t b = 0; b < buckets; b++)
+    {
+        // open addressing over vertex numbers, at most half full
+        size_t capacity = 16;
+        while (capacity < (bucketStart[b + 1] - bucketStart[b]) * 2)
+            capacity *= 2;
+        table.assign(capacity, empty);
+        for (size_t k = bucketStart[b]; k < bucketStart[b + 1]; k++)
+        {
+            unsigned int i = order[k];
+            size_t slot = (hashes[i] / buckets) & (capacity - 1);
+            while (table[slot] != empty && (hashes[table[slot]] != hashes[i] || !WeldEqual(vertices[table[slot]], vertices[i], scale)))
+                slot = (slot + 1) & (capacity - 1);
+            if (table[slot] == empty)
+                table[slot] = i;
+            representative[i] = table[slot];
+        }
+    }
+
+    // number the kept vertices in order, a representative always comes before the vertices it stands for
+    std::vector<unsigned int> remap(count);
+    std::vector<Vertex> welded;
+    welded.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (representative[i] == i)
+        {
+            remap[i] = welded.size();
+            welded.push_back(vertices[i]);
+        }
+        else
+        {
+            remap[i] = remap[representative[i]];
+        }
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    // usually a fraction of the importer's vertices, let the surplus go
+    vertices.assign(welded.begin(), welded.end());
+    vertices.shrink_to_fit();
+}
+
+// vertex cache
+// ------------
+const unsigned int FORSYTH_CACHE_SIZE = 32;
+
+inline float ForsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the last triangle's vertices get a fixed score so the next triangle does not just reuse one of its edges
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    // favor vertices with few triangles left, so no lone triangles are left behind
+    return score + 2.0f / std::sqrt((float)remainingTriangles);
+}
+
+inline void OptimizeVertexCache(ArenaVector<unsigned int> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of every vertex, still to be emitted ones first
+    std::vector<unsigned int> remaining(vertexCount, 0), firstTriangle(vertexCount + 1, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size()), filled(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            adjacency[firstTriangle[v] + filled[v]++] = t;
+        }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount), triangleScore(triangleCount, 0.0f);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            triangleScore[t] += vertexScore[indices[t * 3 + k]];
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    size_t cursor = 0;
+    int best = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        if (best < 0)
+        {
+            // nothing useful in the cache, continue with the next triangle in input order
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+        emitted[best] = true;
+        const unsigned int *triangle = &indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // the triangle is done with its vertices
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            unsigned int *begin = &adjacency[firstTriangle[v]], *end = begin + remaining[v];
+            std::swap(*std::find(begin, end, (unsigned int)best), *(end - 1));
+            remaining[v]--;
+        }
+
+        // LRU update: the triangle's vertices move to the front
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++)
+        {
+            // evicted, its score falls back to the valence part
+            cachePosition[nextCache[i]] = -1;
+            float score = ForsythVertexScore(-1, remaining[nextCache[i]]);
+            for (unsigned int j = 0; j < remaining[nextCache[i]]; j++)
+                triangleScore[adjacency[firstTriangle[nextCache[i]] + j]] += score - vertexScore[nextCache[i]];
+            vertexScore[nextCache[i]] = score;
+        }
+        nextCache.resize(std::min<size_t>(nextCache.size(), FORSYTH_CACHE_SIZE));
+        cache.swap(nextCache);
+
+        // rescore what is in the cache and pick the best triangle touching it
+        best = -1;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            cachePosition[v] = i;
+            float score = ForsythVertexScore(i, remaining[v]);
+            for (unsigned int j = 0; j < remaining[v]; j++)
+                triangleScore[adjacency[firstTriangle[v] + j]] += score - vertexScore[v];
+            vertexScore[v] = score;
+        }
+        for (unsigned int v : cache)
+        {
+            for (unsigned int j = 0; j < remaining[v]; j++)
+            {
+                unsigned int t = adjacency[firstTriangle[v] + j];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices.assign(result.begin(), result.end());
+}
+
+// overdraw
+// --------
+inline void OptimizeOverdraw(ArenaVector<unsigned int> &indices, const ArenaVector<Vertex> &vertices, unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // split where a triangle misses the cache with all three vertices: reordering the runs between such
+    // points cannot cost more than a few misses at each seam
+    std::vector<size_t> clusterStart;
+    std::vector<size_t> enteredAt(vertices.size(), 0);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int index = indices[t * 3 + k];
+            if (enteredAt[index] == 0 || misses - enteredAt[index] + 1 > cacheSize)
+            {
+                misses++;
+                enteredAt[index] = misses;
+                triangleMisses++;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusterStart.push_back(t);
+    }
+    clusterStart.push_back(triangleCount);
+    size_t clusterCount = clusterStart.size() - 1;
+    if (clusterCount < 2)
+        return;
+
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCenter(clusterCount, glm::vec3(0.0f)), clusterNormal(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterArea(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].Position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, p - a);
+            float area = glm::length(normal);
+            clusterCenter[c] += (a + b + p) * (area / 3.0f);
+            clusterNormal[c] += normal;
+            clusterArea[c] += area;
+        }
+        meshCenter += clusterCenter[c];
+        meshArea += clusterArea[c];
+        if (clusterArea[c] > 0.0f)
+            clusterCenter[c] /= clusterArea[c];
+    }
+    if (meshArea > 0.0f)
+        meshCenter /= meshArea;
+
+    // clusters far out along their own normal tend to hide the rest of the mesh, draw them first
+    std::vector<float> key(clusterCount);
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float normalLength = glm::length(clusterNormal[c]);
+        key[c] = normalLength > 0.0f ? glm::dot(clusterCenter[c] - meshCenter, clusterNormal[c] / normalLength) : 0.0f;
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    indices.assign(result.begin(), result.end());
+}
+
+// vertex fetch
+// ------------
+// renumbers the vertices in first use order and drops the unused ones
+inline void OptimizeVertexFetch(ArenaVector<Vertex> &vertices, ArenaVector<unsigned int> &indices)
+{
+    const unsigned int unassigned = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unassigned);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == unassigned)
+        {
+            remap[index] = result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.assign(result.begin(), result.end());
+}
+
+// runs the whole optimization on an imported mesh and reports the cache statistics before and after
+inline bool OptimizeMeshData(MeshData &mesh, VertexCacheStats &before, VertexCacheStats &after)
+{
+    if (mesh.indices.size() < 3 || mesh.indices.size() % 3 != 0)
+        return false;
+    for (unsigned int index : mesh.indices)
+        if (index >= mesh.vertices.size())
+            return false;
+    before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    OptimizeOverdraw(mesh.indices, mesh.vertices);
+    OptimizeVertexFetch(mesh.vertices, mesh.indices);
+    after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    return true;
+}
+
+// meshlets
+// --------
+// triangles facing further than this (a cosine) from a meshlet's mean normal start a new one, so cones stay cullable
+const float MESHLET_MIN_FACING = 0.7f;
+// how many of the following triangles are looked at when a meshlet has no connected triangle left to add
+const unsigned int MESHLET_ISLAND_LOOKAHEAD = 64;
+
+inline void finishMeshlet(const MeshData &mesh, const ArenaVector<unsigned int> &indices, const std::vector<unsigned int> &vertices, Meshlet &meshlet)
+{
+    glm::vec3 low = mesh.vertices[vertices[0]].Position, high = low;
+    for (unsigned int vertex : vertices)
+    {
+        low = glm::min(low, mesh.vertices[vertex].Position);
+        high = glm::max(high, mesh.vertices[vertex].Position);
+    }
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (unsigned int vertex : vertices)
+        meshlet.radius = std::max(meshlet.radius, glm::length(mesh.vertices[vertex].Position - meshlet.center));
+
+    // the normal cone: around the mean face normal, as wide as the normal furthest from it
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3)
+    {
+        const glm::vec3 &a = mesh.vertices[indices[i]].Position;
+        glm::vec3 normal = glm::cross(mesh.vertices[indices[i + 1]].Position - a, mesh.vertices[indices[i + 2]].Position - a);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+    }
+    float axisLength = glm::length(axis);
+    meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    float minimumDot = axisLength > 0.0f ? 1.0f : -1.0f;
+    for (const glm::vec3 &normal : normals)
+        minimumDot = std::min(minimumDot, glm::dot(normal, meshlet.coneAxis));
+    // past about 84 degrees the cone is no use and the test would only cost precision
+    meshlet.coneCutoff = minimumDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+}
+
+// splits a large optimized mesh into meshlets and reorders its triangles so each meshlet is one run of the index
+// buffer, unless the culling is not expected to make up for the vertex cache efficiency lost. A meshlet grows from a seed over triangles sharing its vertices, preferring ones that add few vertices and
+// face the way the meshlet already does, which keeps the normal cones narrow enough to cull. Seeds are taken in the
+// cache optimized order, so the meshlets still follow it.
+inline void BuildMeshlets(MeshData &mesh)
+{
+    mesh.meshlets.clear();
+    size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount < MESHLET_MIN_MESH_TRIANGLES || mesh.indices.size() % 3 != 0)
+        return;
+    size_t vertexCount = mesh.vertices.size();
+
+    // triangles around each vertex
+    std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0), adjacency(mesh.indices.size());
+    for (unsigned int index : mesh.indices)
+        adjacencyStart[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyStart[v + 1] += adjacencyStart[v];
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+        adjacency[fill[mesh.indices[i]]++] = i / 3;
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 &a = mesh.vertices[mesh.indices[t * 3]].Position;
+        glm::vec3 normal = glm::cross(mesh.vertices[mesh.indices[t * 3 + 1]].Position - a, mesh.vertices[mesh.indices[t * 3 + 2]].Position - a);
+        float length = glm::length(normal);
+        normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // the meshlet a vertex was last added to, + 1
+    std::vector<unsigned int> seenIn(vertexCount, 0);
+    ArenaVector<unsigned int> reordered;
+    std::vector<unsigned int> vertices, candidates;
+    reordered.reserve(mesh.indices.size());
+    size_t seed = 0;
+    while (reordered.size() < mesh.indices.size())
+    {
+        while (emitted[seed])
+            seed++;
+        unsigned int meshletId = mesh.meshlets.size() + 1;
+        Meshlet meshlet = {};
+        meshlet.indexOffset = reordered.size();
+        vertices.clear();
+        candidates.clear();
+        glm::vec3 axis(0.0f);
+
+        size_t next = seed;
+        while (true)
+        {
+            // take the triangle
+            emitted[next] = true;
+            axis += normals[next];
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int vertex = mesh.indices[next * 3 + k];
+                reordered.push_back(vertex);
+                if (seenIn[vertex] != meshletId)
+                {
+                    seenIn[vertex] = meshletId;
+                    vertices.push_back(vertex);
+                    for (unsigned int i = adjacencyStart[vertex]; i < adjacencyStart[vertex + 1]; i++)
+                        if (!emitted[adjacency[i]])
+                            candidates.push_back(adjacency[i]);
+                }
+            }
+            meshlet.indexCount += 3;
+            if (meshlet.indexCount / 3 == MESHLET_MAX_TRIANGLES)
+                break;
+
+            // the best neighbour that still fits
+            float axisLength = glm::length(axis);
+            glm::vec3 direction = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f);
+            float bestScore = 1e9f;
+            size_t best = 0, kept = 0;
+            for (unsigned int candidate : candidates)
+            {
+                if (emitted[candidate])
+                    continue;
+                candidates[kept++] = candidate;
+                unsigned int newVertices = 0;
+                for (int k = 0; k < 3; k++)
+                    newVertices += seenIn[mesh.indices[candidate * 3 + k]] != meshletId;
+                float facing = glm::dot(normals[candidate], direction);
+                if (vertices.size() + newVertices > MESHLET_MAX_VERTICES || facing < MESHLET_MIN_FACING)
+                    continue;
+                float score = newVertices + 2.0f * (1.0f - facing);
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    best = candidate;
+                }
+            }
+            candidates.resize(kept);
+            if (bestScore != 1e9f)
+            {
+                next = best;
+                continue;
+            }
+            // nothing connected fits (foliage is full of small islands), go on with one of the next triangles in cache
+            // order that faces the same way
+            while (seed < triangleCount && emitted[seed])
+                seed++;
+            next = triangleCount;
+            for (size_t t = seed, looked = 0; t < triangleCount && looked < MESHLET_ISLAND_LOOKAHEAD; t++)
+            {
+                if (emitted[t])
+                    continue;
+                looked++;
+                if (glm::dot(normals[t], direction) >= MESHLET_MIN_FACING)
+                {
+                    next = t;
+                    break;
+                }
+            }
+            if (next == triangleCount || vertices.size() + 3 > MESHLET_MAX_VERTICES)
+                break;
+        }
+
+        // the growth order is not cache friendly, reorder the meshlet's own triangles on its local vertex numbers
+        ArenaVector<unsigned int> local(reordered.begin() + meshlet.indexOffset, reordered.end());
+        for (unsigned int &index : local)
+            index = std::find(vertices.begin(), vertices.end(), index) - vertices.begin();
+        OptimizeVertexCache(local, vertices.size());
+        for (size_t i = 0; i < local.size(); i++)
+            reordered[meshlet.indexOffset + i] = vertices[local[i]];
+        finishMeshlet(mesh, reordered, vertices, meshlet);
+        mesh.meshlets.push_back(meshlet);
+    }
+
+    // meshlets cost vertex cache efficiency at their borders, only keep them where the cones are expected to win it
+    // back: a cone of half angle a faces away from (1 - sin(a)) / 2 of all view directions
+    double backfacing = 0.0;
+    for (const Meshlet &meshlet : mesh.meshlets)
+        backfacing += (1.0 - meshlet.coneCutoff) * 0.5 * meshlet.indexCount;
+    backfacing /= mesh.indices.size();
+    float split = AnalyzeVertexCache(reordered, vertexCount).acmr, whole = AnalyzeVertexCache(mesh.indices, vertexCount).acmr;
+    if (split * (1.0 - backfacing) >= whole)
+    {
+        mesh.meshlets.clear();
+        return;
+    }
+    mesh.indices.assign(reordered.begin(), reordered.end());
+    // the triangle order changed, renumber the vertices for fetch again (meshlets only hold index ranges)
+    OptimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+#endif
@@ -0,0 +1,517 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Level of detail chains: quadric error edge collapse (Garland and Heckbert) that only ever collapses a vertex onto
+// one of its neighbours, so every level is just another index list over the mesh's own vertex buffer. The levels
+// are appended to the mesh's indices at import and cached with it (see MeshLod in mesh.h), Mesh::Draw picks one by
+// the size its error would have on screen.
+//
+// Vertices split at one position by their normals or texture coordinates move together and only where every copy has
+// a matching copy to land on, so seams stay where they were. Open borders, which foliage cards are made of, only
+// collapse along themselves and carry extra quadrics that keep them from shrinking. The error stored with a level is
+// measured on the result, not taken from the quadrics.
+
+// levels in a chain, counting the full mesh
+const unsigned int MESH_LOD_LEVELS = 4;
+// each level aims at this fraction of the triangles of the one before
+const float MESH_LOD_REDUCTION = 0.5f;
+// meshes with fewer triangles get no chain
+const unsigned int MESH_LOD_MIN_TRIANGLES = 1024;
+// collapses stop at this quadric error, as a fraction of the mesh's bounding radius
+const float MESH_LOD_MAX_ERROR = 0.05f;
+
+// symmetric 4x4 error quadric with the weight it was built from
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+    double weight = 0;
+
+    // plane n.p + d = 0, n unit length
+    void AddPlane(const glm::dvec3 &n, double d, double w)
+    {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+        a22 += w * n.z * n.z; a23 += w * n.z * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+
+    void Add(const Quadric &q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03; a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23; a33 += q.a33; weight += q.weight;
+    }
+
+    // weighted mean squared distance of p to the planes
+    double Error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                 + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                 + a22 * z * z + 2 * a23 * z + a33;
+        return weight > 0 ? std::fabs(e) / weight : 0.0;
+    }
+};
+
+// distance from p to the triangle abc (closest point, Ericson)
+inline float PointTriangleDistance(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return glm::length(ap);
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return glm::length(bp);
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return glm::length(cp);
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+    float denominator = 1.0f / (va + vb + vc);
+    return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+}
+
+// Works on position groups: the vertices sharing a position (its wedges, split by normals or texture coordinates)
+// always move together, each onto the wedge of the target group it shares a triangle with. The topology is taken
+// between groups, so attribute seams are not borders.
+class MeshSimplifier
+{
+public:
+    // the mesh's current triangles, simplified further by every call to Simplify
+    std::vector<unsigned int> indices;
+
+    MeshSimplifier(const ArenaVector<Vertex> &vertices, const ArenaVector<unsigned int> &sourceIndices)
+        : indices(sourceIndices.begin(), sourceIndices.end()), positions(vertices.size()), group(vertices.size()), wedgeNext(vertices.size()),
+          kinds(vertices.size(), Manifold), quadrics(vertices.size()), remap(vertices.size()), used(vertices.size(), false)
+    {
+        for (size_t v = 0; v < vertices.size(); v++)
+            positions[v] = vertices[v].Position;
+        for (unsigned int index : indices)
+            used[index] = true;
+        buildGroups();
+        classifyGroups();
+        buildQuadrics();
+        for (size_t v = 0; v < remap.size(); v++)
+            remap[v] = v;
+        current = remap;
+    }
+
+    // collapses edges until at most targetIndexCount indices are left or the next collapse would cost more than
+    // maxError (by the quadrics)
+    void Simplify(size_t targetIndexCount, float maxError)
+    {
+        double maxSquared = (double)maxError * maxError;
+        std::vector<Collapse> collapses;
+        std::vector<bool> locked;
+        while (indices.size() > targetIndexCount)
+        {
+            buildAdjacency();
+            collectCollapses(collapses);
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+            for (size_t v = 0; v < remap.size(); v++)
+                remap[v] = v;
+            locked.assign(positions.size(), false);
+            size_t trianglesLeft = indices.size() / 3, targetTriangles = targetIndexCount / 3;
+            size_t performed = 0;
+            for (const Collapse &collapse : collapses)
+            {
+                if (collapse.error > maxSquared || trianglesLeft <= targetTriangles)
+                    break;
+                if (locked[collapse.from] || locked[collapse.to] || !findPartners(collapse.from, collapse.to) ||
+                    flipsTriangles(collapse.from, collapse.to))
+                    continue;
+                // never let part of the surface vanish, the levels' errors would no longer be bounded
+                size_t shared = sharedTriangles(collapse.from, collapse.to);
+                size_t remaining = groupTriangles[collapse.from] + groupTriangles[collapse.to] - 2 * shared;
+                bool orphans = remaining == 0;
+                for (unsigned int corner : opposite)
+                    orphans |= groupTriangles[corner] <= 1;
+                if (orphans)
+                    continue;
+
+                for (size_t i = 0; i < partners.size(); i += 2)
+                    remap[partners[i]] = partners[i + 1];
+                locked[collapse.from] = locked[collapse.to] = true;
+                quadrics[collapse.to].Add(quadrics[collapse.from]);
+                groupTriangles[collapse.to] = remaining;
+                for (unsigned int corner : opposite)
+                    groupTriangles[corner]--;
+                trianglesLeft -= shared;
+                performed++;
+            }
+            if (performed == 0)
+                break;
+            applyRemap();
+        }
+    }
+
+    // the largest distance from an original vertex to the simplified surface around the vertex it ended up as, an
+    // upper bound of how far the surface moved
+    float MeasureError()
+    {
+        buildAdjacency();
+        float error = 0.0f;
+        for (size_t v = 0; v < positions.size(); v++)
+        {
+            if (!used[v])
+                continue;
+            unsigned int target = current[v];
+            float nearest = glm::length(positions[v] - positions[target]);
+            for (unsigned int i = adjacencyStart[target]; i < adjacencyStart[target + 1]; i++)
+            {
+                const unsigned int *triangle = &indices[adjacency[i] * 3];
+                nearest = std::min(nearest, PointTriangleDistance(positions[v], positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]));
+            }
+            error = std::max(error, nearest);
+        }
+        return error;
+    }
+
+private:
+    enum Kind { Manifold, Border, Locked };
+
+    // groups are named by their first vertex
+    struct Collapse {
+        unsigned int from, to;
+        double error;
+    };
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> group, wedgeNext; // wedges of a group form a ring through wedgeNext
+    std::vector<unsigned char> kinds;           // per group
+    std::vector<Quadric> quadrics;              // per group
+    std::vector<unsigned int> remap;            // this pass, per vertex
+    std::vector<unsigned int> current;          // what each original vertex has become
+    std::vector<bool> used;
+    // open edges between groups as (from << 32 | to), in the winding of the one triangle using them
+    std::unordered_map<uint64_t, bool> borderEdges;
+    std::vector<unsigned int> adjacencyStart, adjacency;
+    std::vector<size_t> groupTriangles;
+    // (wedge, partner) pairs found by the last findPartners
+    std::vector<unsigned int> partners;
+    // groups across the triangles the last sharedTriangles counted
+    std::vector<unsigned int> opposite;
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return (uint64_t)a << 32 | b;
+    }
+
+    void buildGroups()
+    {
+        std::unordered_map<uint64_t, std::vector<unsigned int>> byHash;
+        for (size_t v = 0; v < positions.size(); v++)
+        {
+            group[v] = v;
+            wedgeNext[v] = v;
+            std::vector<unsigned int> &candidates = byHash[HashBytes(&positions[v], sizeof(glm::vec3))];
+            for (unsigned int other : candidates)
+            {
+                if (positions[other] == positions[v])
+                {
+                    group[v] = other;
+                    wedgeNext[v] = wedgeNext[other];
+                    wedgeNext[other] = v;
+                    break;
+                }
+            }
+            if (group[v] == v)
+                candidates.push_back(v);
+        }
+    }
+
+    void classifyGroups()
+    {
+        // an edge between groups without its reverse is open, one used twice the same way is not manifold
+        std::unordered_map<uint64_t, unsigned int> directed;
+        for (size_t i = 0; i < indices.size(); i += 3)
+            for (int k = 0; k < 3; k++)
+                directed[edgeKey(group[indices[i + k]], group[indices[i + (k + 1) % 3]])]++;
+        std::vector<unsigned int> openEdges(positions.size(), 0);
+        for (const auto &edge : directed)
+        {
+            unsigned int a = edge.first >> 32, b = (unsigned int)edge.first;
+            if (edge.second > 1)
+            {
+                kinds[a] = kinds[b] = Locked;
+                continue;
+            }
+            if (directed.count(edgeKey(b, a)) != 0)
+                continue;
+            borderEdges[edge.first] = true;
+            openEdges[a]++;
+            openEdges[b]++;
+        }
+        for (size_t v = 0; v < positions.size(); v++)
+        {
+            if (kinds[v] == Locked || openEdges[v] == 0)
+                continue;
+            // a vertex where several borders meet has no single line to slide along
+            kinds[v] = openEdges[v] == 2 ? Border : Locked;
+        }
+    }
+
+    void buildQuadrics()
+    {
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            glm::dvec3 a(positions[indices[i]]), b(positions[indices[i + 1]]), c(positions[indices[i + 2]]);
+            glm::dvec3 normal = glm::cross(b - a, c - a);
+            double length = glm::length(normal);
+            if (length == 0.0)
+                continue;
+            normal /= length;
+            // weighted by area, so small triangles do not pin large flat regions
+            Quadric plane;
+            plane.AddPlane(normal, -glm::dot(normal, a), length * 0.5);
+            for (int k = 0; k < 3; k++)
+                quadrics[group[indices[i + k]]].Add(plane);
+
+            // open edges also get a plane through them, perpendicular to the triangle
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int from = group[indices[i + k]], to = group[indices[i + (k + 1) % 3]];
+                if (!borderEdges.count(edgeKey(from, to)))
+                    continue;
+                glm::dvec3 p0(positions[from]), p1(positions[to]);
+                glm::dvec3 edge = p1 - p0;
+                double edgeLength = glm::length(edge);
+                if (edgeLength == 0.0)
+                    continue;
+                glm::dvec3 perpendicular = glm::normalize(glm::cross(edge, normal));
+                Quadric border;
+                border.AddPlane(perpendicular, -glm::dot(perpendicular, p0), edgeLength * edgeLength * 10.0);
+                quadrics[from].Add(border);
+                quadrics[to].Add(border);
+            }
+        }
+    }
+
+    void buildAdjacency()
+    {
+        adjacencyStart.assign(positions.size() + 1, 0);
+        for (unsigned int index : indices)
+            adjacencyStart[index + 1]++;
+        for (size_t v = 0; v < positions.size(); v++)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(indices.size());
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+        groupTriangles.assign(positions.size(), 0);
+        for (size_t v = 0; v < positions.size(); v++)
+            groupTriangles[group[v]] += adjacencyStart[v + 1] - adjacencyStart[v];
+    }
+
+    bool canCollapse(unsigned int from, unsigned int to) const
+    {
+        if (kinds[from] == Manifold)
+            return true;
+        // borders only slide along themselves, in either direction of the open edge
+        return kinds[from] == Border && kinds[to] != Manifold &&
+               (borderEdges.count(edgeKey(from, to)) || borderEdges.count(edgeKey(to, from)));
+    }
+
+    void collectCollapses(std::vector<Collapse> &collapses)
+    {
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = group[indices[i + k]], b = group[indices[i + (k + 1) % 3]];
+                // every inner edge shows up twice, keep it once; open edges show up once
+                if (a > b && !borderEdges.count(edgeKey(a, b)))
+                    continue;
+                Collapse best = {a, b, -1.0};
+                if (canCollapse(a, b))
+                    best.error = quadrics[a].Error(positions[b]);
+                if (canCollapse(b, a))
+                {
+                    double reverse = quadrics[b].Error(positions[a]);
+                    if (best.error < 0.0 || reverse < best.error)
+                        best = {b, a, reverse};
+                }
+                if (best.error >= 0.0)
+                    collapses.push_back(best);
+            }
+        }
+    }
+
+    // pairs every wedge of group from with the one wedge of group to it shares triangles with, fails if there is
+    // none or more than one, the attributes would not carry over
+    bool findPartners(unsigned int from, unsigned int to)
+    {
+        partners.clear();
+        unsigned int wedge = from;
+        do
+        {
+            unsigned int partner = ~0u;
+            for (unsigned int i = adjacencyStart[wedge]; i < adjacencyStart[wedge + 1]; i++)
+            {
+                const unsigned int *triangle = &indices[adjacency[i] * 3];
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int corner = remap[triangle[k]];
+                    if (group[corner] != to)
+                        continue;
+                    if (partner != ~0u && partner != corner)
+                        return false;
+                    partner = corner;
+                }
+            }
+            if (partner == ~0u && adjacencyStart[wedge] != adjacencyStart[wedge + 1])
+                return false;
+            if (partner != ~0u)
+            {
+                partners.push_back(wedge);
+                partners.push_back(partner);
+            }
+            wedge = wedgeNext[wedge];
+        } while (wedge != from);
+        return !partners.empty();
+    }
+
+    // the triangles around group from that stay would turn over when it moves onto group to
+    bool flipsTriangles(unsigned int from, unsigned int to) const
+    {
+        unsigned int wedge = from;
+        do
+        {
+            for (unsigned int i = adjacencyStart[wedge]; i < adjacencyStart[wedge + 1]; i++)
+            {
+                const unsigned int *triangle = &indices[adjacency[i] * 3];
+                glm::vec3 before[3], after[3];
+                bool collapses = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int cornerGroup = group[remap[triangle[k]]];
+                    collapses |= cornerGroup == to;
+                    before[k] = positions[cornerGroup];
+                    after[k] = cornerGroup == from ? positions[to] : before[k];
+                }
+                if (collapses)
+                    continue;
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+                    return true;
+            }
+            wedge = wedgeNext[wedge];
+        } while (wedge != from);
+        return false;
+    }
+
+    // the triangles that disappear with the collapse
+    size_t sharedTriangles(unsigned int from, unsigned int to)
+    {
+        opposite.clear();
+        unsigned int wedge = from;
+        do
+        {
+            for (unsigned int i = adjacencyStart[wedge]; i < adjacencyStart[wedge + 1]; i++)
+            {
+                const unsigned int *triangle = &indices[adjacency[i] * 3];
+                unsigned int corners[3] = {group[remap[triangle[0]]], group[remap[triangle[1]]], group[remap[triangle[2]]]};
+                if (corners[0] != to && corners[1] != to && corners[2] != to)
+                    continue;
+                for (unsigned int corner : corners)
+                    if (corner != from && corner != to)
+                        opposite.push_back(corner);
+            }
+            wedge = wedgeNext[wedge];
+        } while (wedge != from);
+        return opposite.size();
+    }
+
+    void applyRemap()
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+        for (unsigned int &vertex : current)
+            vertex = remap[vertex];
+
+        // collapsed open edges hand their open side over to the group they moved to
+        std::unordered_map<uint64_t, bool> moved;
+        for (const auto &edge : borderEdges)
+        {
+            unsigned int a = group[remap[edge.first >> 32]], b = group[remap[(unsigned int)edge.first]];
+            if (a != b)
+                moved[edgeKey(a, b)] = true;
+        }
+        borderEdges.swap(moved);
+    }
+};
+
+// appends a level of detail chain to a mesh's indices (the full mesh stays first) and fills mesh.lods. Each level is
+// simplified from the one before and reordered for the vertex cache.
+inline void BuildLods(MeshData &mesh)
+{
+    mesh.lods.clear();
+    size_t fullCount = mesh.indices.size();
+    if (fullCount / 3 < MESH_LOD_MIN_TRIANGLES || fullCount % 3 != 0)
+        return;
+
+    glm::vec3 low = mesh.vertices[0].Position, high = low;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        low = glm::min(low, vertex.Position);
+        high = glm::max(high, vertex.Position);
+    }
+    float maxError = glm::length(high - low) * 0.5f * MESH_LOD_MAX_ERROR;
+
+    mesh.lods.push_back({0, (uint32_t)fullCount, 0.0f});
+    // the levels add up to less than the full mesh, grow the index list once
+    mesh.indices.reserve(fullCount * 2);
+    MeshSimplifier simplifier(mesh.vertices, mesh.indices);
+    size_t previous = fullCount;
+    for (unsigned int level = 1; level < MESH_LOD_LEVELS; level++)
+    {
+        size_t target = (size_t)(previous / 3 * MESH_LOD_REDUCTION) * 3;
+        simplifier.Simplify(target, maxError);
+        // not worth a level if the error limit stopped it early
+        if (simplifier.indices.size() > previous * 0.8f || simplifier.indices.empty())
+            break;
+        float error = simplifier.MeasureError();
+        ArenaVector<unsigned int> levelIndices(simplifier.indices.begin(), simplifier.indices.end());
+        OptimizeVertexCache(levelIndices, mesh.vertices.size());
+        mesh.lods.push_back({(uint32_t)mesh.indices.size(), (uint32_t)levelIndices.size(), error});
+        mesh.indices.insert(mesh.indices.end(), levelIndices.begin(), levelIndices.end());
+        previous = levelIndices.size();
+    }
+    if (mesh.lods.size() == 1)
+        mesh.lods.clear();
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+// Meshlets: large meshes are split at import into short runs of their index buffer (see BuildMeshlets in
+// mesh_optimizer.h), each with a bounding sphere and a cone bounding its triangle normals. Every frame the runs
+// outside the view frustum or facing away from the camera are dropped and the rest is drawn with one
+// glMultiDrawElements. Everything is tested in model space, so one set of bounds serves every drawn instance.
+
+// size limits of a meshlet, small enough for tight cones and big enough to keep the draw ranges few
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 126;
+// meshes with fewer triangles are not split, culling them as a whole is enough
+const unsigned int MESHLET_MIN_MESH_TRIANGLES = 2048;
+
+struct Meshlet {
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneAxis;
+    float coneCutoff;     // sine of the cone's half angle, 1 if the normals spread too far to ever cull
+    uint32_t indexOffset; // into the mesh's index buffer
+    uint32_t indexCount;
+};
+
+// the frustum and the camera of one drawn instance, in its model space
+struct CullView {
+    glm::vec4 planes[6]; // inside where dot(xyz, p) + w >= 0, xyz normalized
+    glm::vec3 eye;
+    float pixelsPerUnit;  // on screen size of one unit at distance one, for picking levels of detail
+    bool backfaceCulling; // off for mirroring transforms, they flip which side of a triangle faces the camera
+};
+
+// triangle counters, reset by the caller every frame
+struct CullStats {
+    unsigned int meshlets = 0;
+    unsigned int meshletsCulled = 0;
+    unsigned int triangles = 0;
+    unsigned int trianglesCulledFrustum = 0;
+    unsigned int trianglesCulledBackface = 0;
+    unsigned int trianglesSkippedLod = 0; // left out by drawing a coarser level of detail
+    unsigned int drawCalls = 0;
+};
+
+// pixelsPerUnit as from Camera::PixelsPerUnit
+inline CullView MakeCullView(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model, float pixelsPerUnit)
+{
+    CullView cullView;
+    cullView.pixelsPerUnit = pixelsPerUnit;
+    // Gribb/Hartmann: the planes are sums of the rows of the clip matrix, in the space the matrix starts from
+    glm::mat4 clip = projection * view * model;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            glm::vec4 plane;
+            for (int column = 0; column < 4; column++)
+                plane[column] = clip[column][3] + (side == 0 ? clip[column][i] : -clip[column][i]);
+            float length = glm::length(glm::vec3(plane));
+            cullView.planes[i * 2 + side] = length > 0.0f ? plane / length : plane;
+        }
+    }
+    cullView.eye = glm::vec3(glm::inverse(view * model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    cullView.backfaceCulling = glm::determinant(glm::mat3(model)) > 0.0f;
+    return cullView;
+}
+
+inline bool SphereInFrustum(const CullView &cullView, const glm::vec3 &center, float radius)
+{
+    for (const glm::vec4 &plane : cullView.planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+// true when every triangle of the meshlet faces away from the eye, wherever in the sphere it lies
+inline bool MeshletBackfacing(const CullView &cullView, const Meshlet &meshlet)
+{
+    glm::vec3 toCenter = meshlet.center - cullView.eye;
+    return cullView.backfaceCulling && glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
+
+#endif
@@ -10,19 +10,33 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/camera.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
 
+#include <cfloat>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// post processing steps every model is imported with. Part of the mesh cache key, so changing them invalidates the caches.
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+// vertices whose attributes all round to the same multiple of this are welded on import (0 welds exact copies only).
+// Also part of the mesh cache key. We weld ourselves instead of passing aiProcess_JoinIdenticalVertices, see WeldVertices.
+const float MODEL_WELD_EPSILON = 1e-5f;
+
 
 
 class Model
@@ -31,72 +45,346 @@ public:
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    // upload the meshes in the compact vertex format (vertex_format.h), the shader must decode it. Set before Upload, and
+    // before Import for a static batch, whose cache holds it encoded.
+    bool compactVertices = false;
+    // keep each mesh's vertices and indices on the CPU after upload, for picking or physics. Set before Upload.
+    bool keepCpuData = false;
+    // static batch: the node hierarchy is baked into the vertices on import, and all meshes share one vertex and index
+    // buffer and are drawn with one multi-draw per material. Set before Import.
+    bool staticBatch = false;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    {
+        Import(path);
+        Upload();
+    }
+
+    // empty model, to be filled in two steps by a ModelLoader
+    Model() : gammaCorrection(false)
+    {
+    }
+
+    // CPU side of loading: reads the mesh cache or runs Assimp. Never touches OpenGL, so it can run on a worker thread.
+    void Import(string const &path)
     {
         loadModel(path);
     }
 
+    // GL side of loading: creates the buffer objects from what Import staged and the textures. With a texture loader
+    // the textures are only handles at first and their images arrive asynchronously, otherwise they load right here.
+    // Must run on the context thread.
+    void Upload(TextureLoader *textureLoader = nullptr)
+    {
+        // the cached and the freshly imported meshes both come down to views of their vertices and indices
+        vector<CachedMesh> staged;
+        if(cacheHit)
+            staged = cache.meshes;
+        else
+            for(const MeshData &data : importedMeshes)
+                staged.push_back(viewOf(data));
+
+        if(staticBatch)
+        {
+            uploadBatch(staged, cacheHit ? cache.batch : importedBatch, textureLoader);
+        }
+        else
+        {
+            meshes.reserve(meshes.size() + staged.size());
+            for(const CachedMesh &source : staged)
+            {
+                meshes.emplace_back(source.vertices, source.vertexCount, source.indices, source.indexCount, loadTextures(source.textures, textureLoader), compactVertices, keepCpuData);
+                meshes.back().meshlets.assign(source.meshlets, source.meshlets + source.meshletCount);
+                meshes.back().lods.assign(source.lods, source.lods + source.lodCount);
+            }
+        }
+
+        // the GL buffers hold the geometry now, drop the staging at once
+        cache.Release();
+        importedMeshes.clear();
+        importedMeshes.shrink_to_fit();
+        importedBatch = CachedBatch();
+        vector<CompactVertex>().swap(batchVertexData);
+        vector<uint16_t>().swap(batchIndexData);
+        importArena.Release();
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        if(batchGroups.empty())
+        {
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                meshes[i].Draw(shader);
+            return;
+        }
+        glBindVertexArray(meshes[0].VAO);
+        for(const BatchGroup &group : batchGroups)
+        {
+            beginBatchDraw();
+            for(unsigned int i = group.firstMesh; i < group.firstMesh + group.meshCount; i++)
+            {
+                drawCounts.push_back(meshes[i].FullIndexCount());
+                drawOffsets.push_back((const void *)((size_t)meshes[i].FirstIndex() * batchIndexSize()));
+                drawBaseVertices.push_back(meshes[i].BaseVertex());
+            }
+            meshes[group.firstMesh].BindMaterial(shader);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), batchIndexType, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // draws what of the model is inside cullView (see MakeCullView), at the level of detail its distance allows.
+    // Models drawn more than once per frame pass a different instance for each copy.
+    void Draw(Shader &shader, const CullView &cullView, CullStats &stats, unsigned int instance = 0)
+    {
+        if(batchGroups.empty())
+        {
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                meshes[i].Draw(shader, cullView, stats, instance);
+            return;
+        }
+        // every mesh of a material adds its visible ranges, the material is drawn with one call
+        bool bound = false;
+        for(const BatchGroup &group : batchGroups)
+        {
+            beginBatchDraw();
+            for(unsigned int i = group.firstMesh; i < group.firstMesh + group.meshCount; i++)
+            {
+                meshes[i].CollectDraws(cullView, stats, instance, drawCounts, drawOffsets);
+                drawBaseVertices.resize(drawCounts.size(), meshes[i].BaseVertex());
+            }
+            if(drawCounts.empty())
+                continue;
+            if(!bound)
+            {
+                glBindVertexArray(meshes[0].VAO);
+                bound = true;
+            }
+            meshes[group.firstMesh].BindMaterial(shader);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), batchIndexType, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
+            stats.drawCalls++;
+        }
+        if(bound)
+        {
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+    }
+
+    // tells the texture loader how much detail the textures need for one drawn instance of the model: each mesh's
+    // bounding sphere is projected with the camera, and its texture coordinate span turns that into texels
+    void RequestTextureDetail(TextureLoader &textureLoader, const glm::mat4 &model, Camera &camera, float viewportHeight)
+    {
+        float pixelsPerUnit = camera.PixelsPerUnit(viewportHeight);
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        for(const Mesh &mesh : meshes)
+        {
+            glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+            float radius = mesh.boundsRadius * scale;
+            // inside the sphere the mesh can fill the screen
+            float distance = std::max(glm::length(center - camera.Position) - radius, 0.1f);
+            float texels = 2.0f * radius / distance * pixelsPerUnit * mesh.texCoordSpan;
+            for(const Texture &texture : mesh.textures)
+                textureLoader.RequestDetail(texture.id, texels);
+        }
+    }
+
+    // a sphere around all the meshes of one instance of the model drawn with model, in world space
+    void BoundingSphere(const glm::mat4 &model, glm::vec3 &center, float &radius) const
+    {
+        glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+        for(const Mesh &mesh : meshes)
+        {
+            low = glm::min(low, mesh.boundsCenter - glm::vec3(mesh.boundsRadius));
+            high = glm::max(high, mesh.boundsCenter + glm::vec3(mesh.boundsRadius));
+        }
+        glm::vec3 local = meshes.empty() ? glm::vec3(0.0f) : (low + high) * 0.5f;
+        float localRadius = 0.0f;
+        for(const Mesh &mesh : meshes)
+            localRadius = std::max(localRadius, glm::length(mesh.boundsCenter - local) + mesh.boundsRadius);
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        center = glm::vec3(model * glm::vec4(local, 1.0f));
+        radius = localRadius * scale;
     }
 
     void SetShaderTextureNamePrefix(std::string prefix) {
+        textureNamePrefix = prefix;
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
     }
+
+    // takes the meshes and textures of other, a fresh load of the same file (see AssetReloader), and leaves it ours.
+    // Nothing is uploaded or freed here, so the swap costs nothing and can happen between any two frames.
+    void Replace(Model &other)
+    {
+        meshes.swap(other.meshes);
+        textures_loaded.swap(other.textures_loaded);
+        textureIndex.swap(other.textureIndex);
+        batchGroups.swap(other.batchGroups);
+        std::swap(batchVertices, other.batchVertices);
+        std::swap(batchIndices, other.batchIndices);
+        std::swap(batchIndexType, other.batchIndexType);
+        SetShaderTextureNamePrefix(textureNamePrefix);
+    }
+
+    // gives the model's references to its textures back to the registry, for a model that is not drawn anymore
+    void ReleaseTextures()
+    {
+        for(const Texture &texture : textures_loaded)
+            TextureRegistry::Instance().Release(texture.id, this->directory + '/' + texture.path);
+        textures_loaded.clear();
+        textureIndex.clear();
+    }
+
+    // switches the textures the model loaded from the file at path (canonical) to the registry's new texture for it,
+    // after the file changed and left a texture it shared with copies of it (see TextureRegistry::Reload)
+    void RepointTextures(const TextureSplit &split)
+    {
+        for(Texture &texture : textures_loaded)
+            if(texture.id == split.from && TextureRegistry::CanonicalPath(this->directory + '/' + texture.path) == split.path)
+                texture.id = split.to;
+        for(Mesh &mesh : meshes)
+            for(Texture &texture : mesh.textures)
+                if(texture.id == split.from && TextureRegistry::CanonicalPath(this->directory + '/' + texture.path) == split.path)
+                    texture.id = split.to;
+    }
 private:
+    string textureNamePrefix;
+    // staging between Import and Upload
+    MeshCache cache;
+    bool cacheHit = false;
+    vector<MeshData> importedMeshes;
+    // backs the vertices and indices of importedMeshes
+    Arena importArena;
+    // a static batch as encoded on import, see buildBatch
+    CachedBatch importedBatch;
+    vector<CompactVertex> batchVertexData;
+    vector<uint16_t> batchIndexData;
+
+    // static batch, the meshes are sorted by material and each material is a run of them
+    struct BatchGroup {
+        unsigned int firstMesh;
+        unsigned int meshCount;
+    };
+    vector<BatchGroup> batchGroups;
+    GeometryAllocation batchVertices, batchIndices;
+    GLenum batchIndexType = GL_UNSIGNED_INT;
+    // draw ranges of the last batch draw, kept to save the allocations
+    vector<GLsizei> drawCounts;
+    vector<const void *> drawOffsets;
+    vector<GLint> drawBaseVertices;
+    size_t weldedFrom = 0, weldedTo = 0; // vertex counts of the import before and after welding
+    // material path -> index into textures_loaded
+    unordered_map<string, unsigned int> textureIndex;
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        this->path = path;
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // try the baked cache first, it is only valid while the source, the import flags and the weld epsilon are unchanged
+        string cachePath = MeshCache::PathFor(path);
+        uint64_t sourceHash = MeshCache::SourceHash(path);
+        if(sourceHash != 0)
+            sourceHash = HashBytes(&MODEL_WELD_EPSILON, sizeof(MODEL_WELD_EPSILON), sourceHash);
+        // batched models bake their node transforms and are cached encoded, their cache is a different one
+        if(sourceHash != 0 && staticBatch)
+        {
+            sourceHash = HashBytes(&staticBatch, sizeof(staticBatch), sourceHash);
+            sourceHash = HashBytes(&compactVertices, sizeof(compactVertices), sourceHash);
+        }
+        cacheHit = sourceHash != 0 && cache.Load(cachePath, sourceHash, MODEL_IMPORT_FLAGS);
+        if(cacheHit)
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        weldedFrom = weldedTo = 0;
+        processNode(scene->mRootNode, scene, aiMatrix4x4());
+
+        ostringstream report;
+        report << "MESH_WELD:: " << path << ": " << weldedFrom << " -> " << weldedTo << " vertices\n";
+
+        // reorder for the vertex cache, overdraw and vertex fetch, split into meshlets and build the LOD chain; cached
+        // with the result, so only paid on import
+        for(size_t i = 0; i < importedMeshes.size(); i++)
+        {
+            VertexCacheStats before, after;
+            if(!OptimizeMeshData(importedMeshes[i], before, after))
+                continue;
+            BuildMeshlets(importedMeshes[i]);
+            BuildLods(importedMeshes[i]);
+            report << "MESH_OPTIMIZER:: " << path << " mesh " << i << ": ACMR " << before.acmr << " -> " << after.acmr
+                   << ", ATVR " << before.atvr << " -> " << after.atvr << ", " << importedMeshes[i].meshlets.size() << " meshlets";
+            for(const MeshLod &lod : importedMeshes[i].lods)
+                report << (&lod == &importedMeshes[i].lods[0] ? ", LOD triangles " : " / ") << lod.indexCount / 3;
+            report << "\n";
+        }
+        report << "MESH_ARENA:: " << path << ": " << importArena.PeakBytesReserved() / 1024 << " KB at most during import, "
+               << importArena.BytesReserved() / 1024 << " KB staged for upload\n";
+        cout << report.str() << flush;
+
+        if(staticBatch)
+        {
+            sortBatch();
+            buildBatch();
+        }
+
+        // bake the result so the next start can skip Assimp
+        if(sourceHash != 0 && !MeshCache::Store(cachePath, sourceHash, MODEL_IMPORT_FLAGS, importedMeshes, importedBatch))
+            cout << "WARNING::MESH_CACHE:: could not write " << cachePath << endl;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // parentTransform takes the node's parent to model space.
+    void processNode(aiNode *node, const aiScene *scene, const aiMatrix4x4 &parentTransform)
     {
+        aiMatrix4x4 transform = parentTransform * node->mTransformation;
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            importedMeshes.push_back(processMesh(mesh, scene, transform));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, transform);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // transform is the node's, applied to the vertices for a static batch
+    MeshData processMesh(aiMesh *mesh, const aiScene *scene, const aiMatrix4x4 &transform)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data(&importArena);
+        ArenaVector<Vertex> &vertices = data.vertices;
+        ArenaVector<unsigned int> &indices = data.indices;
+        vector<pair<string, string>> &textures = data.textures;
+        // sized up front, growing would copy them
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -116,6 +404,8 @@ private:
                 vector.z = mesh->mNormals[i].z;
                 vertex.Normal = vector;
             }
+            else
+                vertex.Normal = glm::vec3(0.0f);
             // texture coordinates
             if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
             {
@@ -137,7 +427,10 @@ private:
                 vertex.Bitangent = vector;
             }
             else
+            {
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                vertex.Tangent = vertex.Bitangent = glm::vec3(0.0f);
+            }
 
             vertices.push_back(vertex);
 
@@ -151,6 +444,12 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        if(staticBatch && !transform.IsIdentity())
+            bakeTransform(transform, vertices, indices);
+        // the importer emits a vertex per face corner, merge the copies
+        weldedFrom += vertices.size();
+        WeldVertices(vertices, indices, MODEL_WELD_EPSILON);
+        weldedTo += vertices.size();
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -164,55 +463,233 @@ private:
 
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
+        loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
 
+        // return the extracted mesh data, the GL objects are created later in Upload
+        return data;
+    }
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+    // moves the vertices into model space. Mirroring transforms also flip the winding, so front faces stay front faces.
+    void bakeTransform(const aiMatrix4x4 &transform, ArenaVector<Vertex> &vertices, ArenaVector<unsigned int> &indices)
+    {
+        glm::mat4 matrix;
+        for(int row = 0; row < 4; row++)
+            for(int column = 0; column < 4; column++)
+                matrix[column][row] = transform[row][column];
+        glm::mat3 linear(matrix);
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        auto direction = [](const glm::vec3 &v) { return glm::length(v) > 0.0f ? glm::normalize(v) : v; };
+        for(Vertex &vertex : vertices)
+        {
+            vertex.Position = glm::vec3(matrix * glm::vec4(vertex.Position, 1.0f));
+            vertex.Normal = direction(normalMatrix * vertex.Normal);
+            vertex.Tangent = direction(linear * vertex.Tangent);
+            vertex.Bitangent = direction(linear * vertex.Bitangent);
+        }
+        if(glm::determinant(linear) < 0.0f)
+            for(size_t i = 0; i + 2 < indices.size(); i += 3)
+                std::swap(indices[i + 1], indices[i + 2]);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects the texture references of a given type, the images themselves are loaded in Upload.
+    void loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, vector<pair<string, string>> &textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            textures.push_back(make_pair(typeName, string(str.C_Str())));
+        }
+    }
+
+    vector<Texture> loadTextures(const vector<pair<string, string>> &references, TextureLoader *textureLoader)
+    {
+        vector<Texture> textures;
+        for(const pair<string, string> &reference : references)
+            textures.push_back(loadTexture(reference.second, reference.first, textureLoader));
+        return textures;
+    }
+
+    static CachedMesh viewOf(const MeshData &data)
+    {
+        CachedMesh view;
+        view.vertices = data.vertices.data();
+        view.vertexCount = data.vertices.size();
+        view.indices = data.indices.data();
+        view.indexCount = data.indices.size();
+        view.meshlets = data.meshlets.data();
+        view.meshletCount = data.meshlets.size();
+        view.lods = data.lods.data();
+        view.lodCount = data.lods.size();
+        view.textures = data.textures;
+        return view;
+    }
+
+    static string materialKey(const vector<pair<string, string>> &textures)
+    {
+        string key;
+        for(const pair<string, string> &texture : textures)
+            key += texture.first + '\n' + texture.second + '\n';
+        return key;
+    }
+
+    // orders the imported meshes of a static batch by material, meshes with the exact same texture list draw alike
+    void sortBatch()
+    {
+        vector<string> keys;
+        for(const MeshData &data : importedMeshes)
+            keys.push_back(materialKey(data.textures));
+        vector<MeshData> sorted;
+        sorted.reserve(importedMeshes.size());
+        vector<bool> placed(importedMeshes.size(), false);
+        for(size_t i = 0; i < importedMeshes.size(); i++)
+        {
+            if(placed[i])
+                continue;
+            for(size_t j = i; j < importedMeshes.size(); j++)
+            {
+                if(placed[j] || keys[j] != keys[i])
+                    continue;
+                sorted.push_back(std::move(importedMeshes[j]));
+                placed[j] = true;
+            }
+        }
+        importedMeshes.swap(sorted);
+    }
+
+    // encodes the sorted batch in the layout it is uploaded in, so that is paid on import and cached: compact vertices
+    // quantized against the bounds of the whole batch, one decode serves every mesh, and 16 bit indices as long as every
+    // mesh fits them (each mesh keeps its own indices, drawn with its base vertex)
+    void buildBatch()
+    {
+        importedBatch = CachedBatch();
+        VertexBounds bounds;
+        size_t vertexTotal = 0, indexTotal = 0;
+        bool shortIndices = true;
+        for(const MeshData &data : importedMeshes)
+        {
+            bounds.Add(data.vertices.data(), data.vertices.size());
+            vertexTotal += data.vertices.size();
+            indexTotal += data.indices.size();
+            shortIndices = shortIndices && data.vertices.size() <= 65536;
+        }
+        if(compactVertices && vertexTotal > 0)
+        {
+            importedBatch.decode = bounds.Decode();
+            batchVertexData.resize(vertexTotal);
+            size_t first = 0;
+            for(const MeshData &data : importedMeshes)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
+                EncodeCompactVertices(data.vertices.data(), data.vertices.size(), importedBatch.decode, batchVertexData.data() + first);
+                first += data.vertices.size();
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+            importedBatch.vertices = batchVertexData.data();
+            importedBatch.vertexCount = (unsigned int)vertexTotal;
+        }
+        if(shortIndices && indexTotal > 0)
+        {
+            batchIndexData.reserve(indexTotal);
+            for(const MeshData &data : importedMeshes)
+                batchIndexData.insert(batchIndexData.end(), data.indices.begin(), data.indices.end());
+            importedBatch.indices = batchIndexData.data();
+            importedBatch.indexCount = (unsigned int)indexTotal;
+        }
+    }
+
+    // uploads the staged meshes of a static batch, sorted by material on import, into one vertex and one index range of
+    // the geometry heap. The ranges are taken at their full size and filled straight from the batch or, where it keeps
+    // the meshes' own format, from each mesh's span of the mapped cache or the import.
+    void uploadBatch(const vector<CachedMesh> &staged, const CachedBatch &batch, TextureLoader *textureLoader)
+    {
+        if(staged.empty())
+            return;
+        size_t vertexTotal = 0, indexTotal = 0;
+        for(const CachedMesh &source : staged)
+        {
+            vertexTotal += source.vertexCount;
+            indexTotal += source.indexCount;
+        }
+
+        GeometryHeap &heap = GeometryHeap::Instance();
+        bool compact = batch.vertices != nullptr;
+        batchVertices = Mesh::AllocateVertexData(batch.vertices, vertexTotal, compact);
+        if(!compact)
+        {
+            size_t first = 0;
+            for(const CachedMesh &source : staged)
+            {
+                heap.Write(batchVertices.Range(), first, source.vertices, source.vertexCount);
+                first += source.vertexCount;
             }
         }
-        return textures;
+        batchIndexType = batch.indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        batchIndices = heap.AllocateIndexData(batch.indices, indexTotal, batchIndexType);
+        if(!batch.indices)
+        {
+            size_t first = 0;
+            for(const CachedMesh &source : staged)
+            {
+                heap.Write(batchIndices.Range(), first * sizeof(unsigned int), source.indices, source.indexCount * sizeof(unsigned int));
+                first += source.indexCount;
+            }
+        }
+
+        MeshBatchSlot slot = {batchVertices.Range(), batchIndices.Range(), batchIndexType, compact, compact ? batch.decode : VertexDecode(), 0, 0};
+        meshes.reserve(meshes.size() + staged.size());
+        string previousKey;
+        for(size_t k = 0; k < staged.size(); k++)
+        {
+            const CachedMesh &source = staged[k];
+            string key = materialKey(source.textures);
+            if(k == 0 || key != previousKey)
+                batchGroups.push_back({(unsigned int)meshes.size(), 0});
+            previousKey = key;
+            batchGroups.back().meshCount++;
+            meshes.emplace_back(source.vertices, source.vertexCount, source.indices, source.indexCount, loadTextures(source.textures, textureLoader), slot, keepCpuData);
+            meshes.back().meshlets.assign(source.meshlets, source.meshlets + source.meshletCount);
+            meshes.back().lods.assign(source.lods, source.lods + source.lodCount);
+            slot.firstIndex += source.indexCount;
+            slot.baseVertex += source.vertexCount;
+        }
+    }
+
+    void beginBatchDraw()
+    {
+        drawCounts.clear();
+        drawOffsets.clear();
+        drawBaseVertices.clear();
+    }
+
+    size_t batchIndexSize() const
+    {
+        return batchIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    }
+
+    // loads a single texture of the model, unless it was loaded before
+    Texture loadTexture(const string &path, const string &typeName, TextureLoader *textureLoader)
+    {
+        // check if texture was loaded before by this model and if so, skip loading a new texture
+        unordered_map<string, unsigned int>::iterator it = textureIndex.find(path);
+        if(it != textureIndex.end())
+            return textures_loaded[it->second];
+        // otherwise take it from the registry, which shares it with every other model using the same image
+        Texture texture;
+        TextureOptions options;
+        // color maps get sRGB correct mips, the other maps hold data
+        options.srgb = typeName == "texture_diffuse";
+        options.streamed = true;
+        texture.id = TextureRegistry::Instance().Acquire(this->directory + '/' + path, textureLoader, options);
+        texture.type = typeName;
+        texture.path = path;
+        textureIndex[path] = textures_loaded.size();
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
 };
 
@@ -224,35 +701,7 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    LoadTextureFile(textureID, filename);
 
     return textureID;
 }
@@ -0,0 +1,75 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Loads several models at once. The CPU work of every model (mesh cache / Assimp import and mesh conversion) runs
+// on the thread pool; finished models go through a completion queue and are uploaded on the GL thread by Finish(),
+// in whatever order they complete. Their textures are requested from the texture loader and decode on the same pool.
+class ModelLoader
+{
+public:
+    ModelLoader(ThreadPool &pool, TextureLoader &textureLoader) : pool(pool), textureLoader(textureLoader)
+    {
+    }
+
+    // starts loading path into model. The model must outlive the call to Finish().
+    void Load(Model &model, const std::string &path)
+    {
+        jobs.emplace_back(new Job(model));
+        Job *job = jobs.back().get();
+        pool.Enqueue([this, job, path]() {
+            job->model.Import(path);
+            jobDone(job);
+        });
+    }
+
+    // blocks until every model is loaded, uploading each one as soon as its CPU work is done. Call on the GL thread.
+    void Finish()
+    {
+        for (size_t uploaded = 0; uploaded < jobs.size(); uploaded++)
+        {
+            Job *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                imported.wait(lock, [this]() { return !completed.empty(); });
+                job = completed.front();
+                completed.pop_front();
+            }
+            job->model.Upload(&textureLoader);
+        }
+        jobs.clear();
+    }
+
+private:
+    struct Job {
+        explicit Job(Model &model) : model(model) {}
+        Model &model;
+    };
+
+    ThreadPool &pool;
+    TextureLoader &textureLoader;
+    std::vector<std::unique_ptr<Job>> jobs;
+    std::deque<Job *> completed;
+    std::mutex mutex;
+    std::condition_variable imported;
+
+    void jobDone(Job *job)
+    {
+        // notify under the lock, Finish() may return and destroy the loader as soon as it sees the last job
+        std::lock_guard<std::mutex> lock(mutex);
+        completed.push_back(job);
+        imported.notify_one();
+    }
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Linked programs saved as driver binaries (ARB_get_program_binary), one file per program next to its vertex shader:
+// "<vertex shader>+<fragment shader name>.programcache". The key hashes the exact sources handed to the compiler
+// together with the vendor, renderer and version strings, so edited shaders and driver updates both miss. The driver
+// may still turn a binary down, a program that does not link from its cache is built from source as usual.
+//
+// Layout: ProgramCacheHeader, then binarySize bytes of the binary in binaryFormat.
+const uint32_t PROGRAM_CACHE_MAGIC   = 0x50424752; // "RGBP"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    float    buildMilliseconds; // what building from source took, to report what a hit saves
+    uint32_t reserved;
+};
+
+// what the cache did since the start of the program
+struct ProgramCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;   // built from source, and stored when the driver allows
+    unsigned int rejected = 0; // binaries the driver did not take anymore, counted as misses too
+    double loadMilliseconds = 0.0;
+    double buildMilliseconds = 0.0;
+    double savedMilliseconds = 0.0; // build time recorded with the hits, minus loading them
+};
+
+class ProgramCache
+{
+public:
+    static std::string PathFor(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath)
+    {
+        std::string path = vertexPath + '+' + fileName(fragmentPath);
+        if (!geometryPath.empty())
+            path += '+' + fileName(geometryPath);
+        return path + ".programcache";
+    }
+
+    // key of a program built from these sources (empty where a stage is missing) by the current driver. GL thread.
+    static uint64_t Key(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        uint64_t hash = HashBytes(nullptr, 0);
+        for (const std::string *code : {&vertexCode, &fragmentCode, &geometryCode})
+        {
+            uint64_t length = code->size();
+            hash = HashBytes(&length, sizeof(length), hash);
+            hash = HashBytes(code->data(), code->size(), hash);
+        }
+        static const std::string driver = driverString();
+        return HashBytes(driver.data(), driver.size(), hash);
+    }
+
+    // links program from the cache at path if it holds key, returns whether the program is linked. buildMilliseconds
+    // is what building it from source took when it was stored.
+    static bool Load(const std::string &path, uint64_t key, unsigned int program, float &buildMilliseconds)
+    {
+        if (!ProgramBinariesSupported())
+            return false;
+        MappedFile file(path);
+        if (!file.isOpen() || file.size < sizeof(ProgramCacheHeader))
+            return false;
+        ProgramCacheHeader header;
+        memcpy(&header, file.data, sizeof(header));
+        if (header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION || header.key != key ||
+            file.size != sizeof(header) + header.binarySize)
+            return false;
+
+        GLExtensions().programBinary(program, header.binaryFormat, file.data + sizeof(header), header.binarySize);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE)
+        {
+            Stats().rejected++;
+            return false;
+        }
+        buildMilliseconds = header.buildMilliseconds;
+        return true;
+    }
+
+    // asks the driver to keep the binary of program retrievable, call before linking it
+    static void PrepareProgram(unsigned int program)
+    {
+        if (ProgramBinariesSupported())
+            GLExtensions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // saves the binary of a linked program under key. Written to a temporary file first so a crash never leaves a
+    // torn cache behind.
+    static bool Store(const std::string &path, uint64_t key, unsigned int program, float buildMilliseconds)
+    {
+        if (!ProgramBinariesSupported())
+            return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        GLExtensions().getProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return false;
+
+        ProgramCacheHeader header;
+        header.magic = PROGRAM_CACHE_MAGIC;
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        header.binaryFormat = format;
+        header.binarySize = (uint32_t)written;
+        header.buildMilliseconds = buildMilliseconds;
+        header.reserved = 0;
+
+        std::string tempPath = path + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write((const char *)&header, sizeof(header));
+        out.write(binary.data(), written);
+        out.close();
+        if (!out)
+        {
+            remove(tempPath.c_str());
+            return false;
+        }
+        return rename(tempPath.c_str(), path.c_str()) == 0;
+    }
+
+    static ProgramCacheStats &Stats()
+    {
+        static ProgramCacheStats stats;
+        return stats;
+    }
+
+private:
+    static std::string driverString()
+    {
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const char *value = (const char *)glGetString(name);
+            driver += value ? value : "";
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    static std::string fileName(const std::string &path)
+    {
+        return path.substr(path.find_last_of('/') + 1);
+    }
+};
+
+#endif
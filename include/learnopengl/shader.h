@@ -4,174 +4,527 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 #include <common.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/program_cache.h>
+
+// a program being compiled and linked from the sources of a Shader, or loaded from the program cache, see
+// Shader::BeginBuild
+struct ShaderBuild {
+    unsigned int program = 0;
+    unsigned int vertex = 0, fragment = 0, geometry = 0;
+    uint64_t cacheKey = 0;
+    bool cached = false;
+    float cachedBuildMilliseconds = 0.0f; // what the cached program took to build from source
+    double milliseconds = 0.0;            // spent in BeginBuild and FinishBuild so far
+};
+
+// a uniform name, taken from a literal or a string without copying it
+struct UniformName {
+    UniformName(const char *text) : text(text) {}
+    UniformName(const std::string &text) : text(text.c_str()) {}
+    const char *text;
+};
+
+// a uniform of a Shader resolved once by name, see Shader::Uniform and Shader::Set
+template <typename T>
+struct UniformHandle {
+    int slot = -1;
+};
+
+// binding point of each uniform block by block name, see UniformBuffer. GLSL 330 has no layout(binding), a program
+// binds the blocks it declares to these whenever it is linked.
+inline std::unordered_map<std::string, unsigned int> &UniformBlockBindings()
+{
+    static std::unordered_map<std::string, unsigned int> bindings;
+    return bindings;
+}
+
+// A program built from shader source files. The Shader object is the handle to hold on to: ID changes when the
+// sources are rebuilt (see ShaderReloader), so it is read from the Shader at every use instead of being kept, and
+// shaders are not copied.
 class Shader
 {
 public:
     unsigned int ID;
+    // the source files, geometryPath is empty without a geometry stage
+    std::string vertexPath, fragmentPath, geometryPath;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
+        ShaderBuild build = BeginBuild();
+        FinishBuild(build);
+    }
 
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
+    // reads the source files and starts compiling and linking them into a new program, without waiting for the
+    // result. A program cached for exactly these sources and this driver is loaded instead (see ProgramCache).
+    // program is 0 when a file could not be read.
+    ShaderBuild BeginBuild() const
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ShaderBuild build;
         // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
+        std::string vertexCode, fragmentCode, geometryCode;
+        if (!readSource(vertexPath, vertexCode) || !readSource(fragmentPath, fragmentCode) ||
+            (!geometryPath.empty() && !readSource(geometryPath, geometryCode)))
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            return build;
+        }
+        build.cacheKey = ProgramCache::Key(vertexCode, fragmentCode, geometryCode);
+        build.program = glCreateProgram();
+        if (ProgramCache::Load(cachePath(), build.cacheKey, build.program, build.cachedBuildMilliseconds))
+        {
+            build.cached = true;
+            build.milliseconds = elapsedMilliseconds(start);
+            return build;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
+        // a binary the driver turned down leaves the program failed, start from a clean one
+        glDeleteProgram(build.program);
+
         // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        build.vertex = compileStage(GL_VERTEX_SHADER, vertexCode);
+        build.fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        if (!geometryPath.empty())
+            build.geometry = compileStage(GL_GEOMETRY_SHADER, geometryCode);
+        // shader Program
+        build.program = glCreateProgram();
+        glAttachShader(build.program, build.vertex);
+        glAttachShader(build.program, build.fragment);
+        if (build.geometry)
+            glAttachShader(build.program, build.geometry);
+        ProgramCache::PrepareProgram(build.program);
+        glLinkProgram(build.program);
+        build.milliseconds = elapsedMilliseconds(start);
+        return build;
+    }
+
+    // whether asking for the result of a build would not stall. Without parallel shader compilation in the driver
+    // the result is always there, the driver just finishes the work when asked.
+    static bool BuildReady(const ShaderBuild &build)
+    {
+        if (build.program == 0 || !ParallelShaderCompileSupported())
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_ARB, &done);
+        return done == GL_TRUE;
+    }
+
+    // checks a build, and when it compiled and linked makes it the program of this shader: the uniforms set on the
+    // old program are carried over and the old program is deleted. A failed build is deleted and the shader keeps
+    // the program it has. A program built from source is stored in the program cache.
+    bool FinishBuild(ShaderBuild &build)
+    {
+        if (build.program == 0)
+            return false;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // a cached program was linked when it was loaded
+        bool success = build.cached;
+        if (!build.cached)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            success = checkCompileErrors(build.vertex, "VERTEX");
+            success = checkCompileErrors(build.fragment, "FRAGMENT") && success;
+            if (build.geometry)
+                success = checkCompileErrors(build.geometry, "GEOMETRY") && success;
+            success = checkCompileErrors(build.program, "PROGRAM") && success;
+            // delete the shaders as they're linked into our program now and no longer necessery
+            glDeleteShader(build.vertex);
+            glDeleteShader(build.fragment);
+            if (build.geometry)
+                glDeleteShader(build.geometry);
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
+        build.milliseconds += elapsedMilliseconds(start);
 
+        ProgramCacheStats &stats = ProgramCache::Stats();
+        if (build.cached)
+        {
+            stats.hits++;
+            stats.loadMilliseconds += build.milliseconds;
+            stats.savedMilliseconds += build.cachedBuildMilliseconds - build.milliseconds;
+        }
+        else
+        {
+            stats.misses++;
+            stats.buildMilliseconds += build.milliseconds;
+            if (success)
+                ProgramCache::Store(cachePath(), build.cacheKey, build.program, (float)build.milliseconds);
+        }
+
+        if (!success)
+        {
+            glDeleteProgram(build.program);
+        }
+        else
+        {
+            if (ID != 0)
+            {
+                copyUniforms(ID, build.program);
+                glDeleteProgram(ID);
+            }
+            ID = build.program;
+            bindUniformBlocks();
+            reflectUniforms();
+        }
+        build = ShaderBuild();
+        return success;
     }
+
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
         glUseProgram(ID); 
     }
-    // utility uniform functions
+    // resolves a uniform once, for setting it with Set. Handles stay valid when the shader is rebuilt, a name the
+    // program does not have (or the compiler dropped) gives a handle whose sets do nothing.
+    template <typename T>
+    UniformHandle<T> Uniform(UniformName name) const
+    {
+        UniformHandle<T> handle;
+        handle.slot = slotFor(name.text);
+        return handle;
+    }
+
+    // sets a uniform of this shader, which has to be in use. Values equal to the last one set skip the GL call.
+    template <typename T>
+    void Set(UniformHandle<T> handle, const T &value) const
+    {
+        if (handle.slot >= 0)
+            setSlot(uniformSlots[handle.slot], value);
+    }
+
+    // utility uniform functions, by name. The names are looked up in the table of the program's uniforms, never in GL.
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformName name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setSlot(uniformSlots[slotFor(name.text)], (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformName name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        setSlot(uniformSlots[slotFor(name.text)], value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformName name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setSlot(uniformSlots[slotFor(name.text)], value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformName name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setSlot(uniformSlots[slotFor(name.text)], value);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(UniformName name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setSlot(uniformSlots[slotFor(name.text)], glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformName name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setSlot(uniformSlots[slotFor(name.text)], value);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(UniformName name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setSlot(uniformSlots[slotFor(name.text)], glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformName name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setSlot(uniformSlots[slotFor(name.text)], value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(UniformName name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setSlot(uniformSlots[slotFor(name.text)], glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformName name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setSlot(uniformSlots[slotFor(name.text)], mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformName name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setSlot(uniformSlots[slotFor(name.text)], mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformName name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setSlot(uniformSlots[slotFor(name.text)], mat);
     }
 
 private:
+    // a uniform of the table, with the last value set on it
+    struct UniformSlot {
+        std::vector<std::string> names; // an array's first element also goes by the array's name
+
+        GLint location = -1;
+        bool known = false; // value holds what the program has
+        unsigned char value[sizeof(glm::mat4)];
+    };
+    // every active uniform of the program, array elements one by one, plus any other name asked for. Slots are never
+    // removed, a rebuild only looks their locations up again, so handles outlive it.
+    mutable std::vector<UniformSlot> uniformSlots;
+    mutable std::unordered_map<uint64_t, int> slotsByHash; // hash of the name -> slot
+
+    // slot of name, added when the table does not have it yet
+    int slotFor(const char *name) const
+    {
+        uint64_t hash = HashBytes(name, strlen(name));
+        std::unordered_map<uint64_t, int>::iterator it = slotsByHash.find(hash);
+        if (it != slotsByHash.end() && hasName(uniformSlots[it->second], name))
+            return it->second;
+        // two names with the same hash, the second is only found by searching
+        for (size_t i = 0; it != slotsByHash.end() && i < uniformSlots.size(); i++)
+            if (hasName(uniformSlots[i], name))
+                return i;
+
+        // another name of a uniform we have shares its slot, so both see the same last value
+        GLint location = ID != 0 ? glGetUniformLocation(ID, name) : -1;
+        int index = -1;
+        for (size_t i = 0; location >= 0 && index < 0 && i < uniformSlots.size(); i++)
+            if (uniformSlots[i].location == location)
+                index = i;
+        if (index < 0)
+        {
+            uniformSlots.push_back(UniformSlot());
+            uniformSlots.back().location = location;
+            index = uniformSlots.size() - 1;
+        }
+        uniformSlots[index].names.push_back(name);
+        if (it == slotsByHash.end())
+            slotsByHash[hash] = index;
+        return index;
+    }
+
+    static bool hasName(const UniformSlot &slot, const char *name)
+    {
+        for (const std::string &slotName : slot.names)
+            if (slotName == name)
+                return true;
+        return false;
+    }
+
+    // fills the table from the program just linked. Its uniforms start out unknown, the values carried over from the
+    // previous program (see copyUniforms) are set again the first time around.
+    void reflectUniforms()
+    {
+        for (UniformSlot &slot : uniformSlots)
+        {
+            slot.location = glGetUniformLocation(ID, slot.names[0].c_str());
+            slot.known = false;
+        }
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, sizeof(name), NULL, &size, &type, name);
+            // uniforms in blocks have no location
+            if (glGetUniformLocation(ID, name) < 0)
+                continue;
+            std::string base = arrayBase(name);
+            if (size == 1)
+                slotFor(name);
+            for (GLint element = 0; size > 1 && element < size; element++)
+                slotFor((base + "[" + std::to_string(element) + "]").c_str());
+        }
+    }
+
+    // binds the uniform blocks of the program to their points in UniformBlockBindings, blocks not in there stay at 0
+    void bindUniformBlocks()
+    {
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            glGetActiveUniformBlockName(ID, i, sizeof(name), NULL, name);
+            std::unordered_map<std::string, unsigned int>::const_iterator binding = UniformBlockBindings().find(name);
+            if (binding != UniformBlockBindings().end())
+                glUniformBlockBinding(ID, i, binding->second);
+            else
+                std::cout << "WARNING::SHADER:: no buffer for uniform block " << name << " in " << vertexPath << std::endl;
+        }
+    }
+
+    template <typename T>
+    void setSlot(UniformSlot &slot, const T &value) const
+    {
+        static_assert(sizeof(T) <= sizeof(slot.value), "uniform larger than its shadow");
+        if (slot.location < 0 || (slot.known && memcmp(slot.value, &value, sizeof(T)) == 0))
+            return;
+        memcpy(slot.value, &value, sizeof(T));
+        slot.known = true;
+        upload(slot.location, value);
+    }
+
+    static void upload(GLint location, bool value) { glUniform1i(location, value); }
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::mat2 &value) { glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void upload(GLint location, const glm::mat3 &value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void upload(GLint location, const glm::mat4 &value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+    std::string cachePath() const
+    {
+        return ProgramCache::PathFor(vertexPath, fragmentPath, geometryPath);
+    }
+
+    static double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static bool readSource(const std::string &path, std::string &code)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        code = stream.str();
+        return true;
+    }
+
+    static unsigned int compileStage(GLenum type, const std::string &code)
+    {
+        const char *source = code.c_str();
+        unsigned int stage = glCreateShader(type);
+        glShaderSource(stage, 1, &source, NULL);
+        glCompileShader(stage);
+        return stage;
+    }
+
+    // sets every uniform of the default block the two programs share, by name and type, to its value in from. Uniform
+    // blocks are bound again from UniformBlockBindings instead.
+    static void copyUniforms(unsigned int from, unsigned int to)
+    {
+        std::unordered_map<std::string, GLenum> targetTypes = uniformTypes(to);
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(to);
+        GLint count = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(from, i, sizeof(name), NULL, &size, &type, name);
+            std::string base = arrayBase(name);
+            std::unordered_map<std::string, GLenum>::iterator target = targetTypes.find(base);
+            if (target == targetTypes.end() || target->second != type)
+                continue;
+            // arrays are reported once, their elements are copied one by one
+            for (GLint element = 0; element < size; element++)
+            {
+                std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : std::string(name);
+                GLint sourceLocation = glGetUniformLocation(from, elementName.c_str());
+                GLint targetLocation = glGetUniformLocation(to, elementName.c_str());
+                if (sourceLocation >= 0 && targetLocation >= 0)
+                    copyUniform(from, sourceLocation, targetLocation, type);
+            }
+        }
+        glUseProgram(previous);
+    }
+
+    // active uniform name (without [0] for arrays) -> type
+    static std::unordered_map<std::string, GLenum> uniformTypes(unsigned int program)
+    {
+        std::unordered_map<std::string, GLenum> types;
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+            types[arrayBase(name)] = type;
+        }
+        return types;
+    }
+
+    static std::string arrayBase(const std::string &name)
+    {
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            return name.substr(0, name.size() - 3);
+        return name;
+    }
+
+    // copies the value at source in program from to target in the program in use
+    static void copyUniform(unsigned int from, GLint source, GLint target, GLenum type)
+    {
+        GLfloat f[16];
+        GLint v[4];
+        GLuint u[4];
+        switch (type)
+        {
+        case GL_FLOAT: glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+        case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+        case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+        case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+        case GL_FLOAT_MAT2: glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT2x3: glGetUniformfv(from, source, f); glUniformMatrix2x3fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT2x4: glGetUniformfv(from, source, f); glUniformMatrix2x4fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3x2: glGetUniformfv(from, source, f); glUniformMatrix3x2fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3x4: glGetUniformfv(from, source, f); glUniformMatrix3x4fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4x2: glGetUniformfv(from, source, f); glUniformMatrix4x2fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4x3: glGetUniformfv(from, source, f); glUniformMatrix4x3fv(target, 1, GL_FALSE, f); break;
+        case GL_UNSIGNED_INT: glGetUniformuiv(from, source, u); glUniform1uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glUniform2uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glUniform3uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glUniform4uiv(target, 1, u); break;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, source, v); glUniform2iv(target, 1, v); break;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, source, v); glUniform3iv(target, 1, v); break;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, source, v); glUniform4iv(target, 1, v); break;
+        // int, bool and the samplers, set through glUniform1i
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_1D_SHADOW:
+        case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_SHADOW: case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE: case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+        case GL_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            glGetUniformiv(from, source, v); glUniform1iv(target, 1, v); break;
+        default:
+            std::cout << "WARNING::SHADER:: uniform of type 0x" << std::hex << type << std::dec << " not kept across the rebuild" << std::endl;
+            break;
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +546,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
@@ -0,0 +1,96 @@
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include <learnopengl/asset_watcher.h>
+#include <learnopengl/shader.h>
+
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Rebuilds shaders while the program runs. When one of a watched shader's source files changes, its program is
+// compiled and linked again; where the driver compiles in parallel (see ParallelShaderCompileSupported) the build is
+// polled each frame instead of waited on. A build that succeeds replaces the shader's program, one that fails only
+// logs its errors and the shader keeps drawing with the program it had.
+class ShaderReloader
+{
+public:
+    explicit ShaderReloader(const std::string &root) : watcher(root)
+    {
+        if (!watcher.IsOpen())
+            std::cout << "WARNING::SHADER_RELOADER:: cannot watch " << root << ", shader reload is off" << std::endl;
+    }
+
+    ShaderReloader(const ShaderReloader &) = delete;
+    ShaderReloader &operator=(const ShaderReloader &) = delete;
+
+    // rebuilds shader whenever one of its files changes. The shader must outlive the reloader.
+    void Watch(Shader &shader)
+    {
+        Watched entry;
+        entry.shader = &shader;
+        for (const std::string *path : {&shader.vertexPath, &shader.fragmentPath, &shader.geometryPath})
+        {
+            char resolved[PATH_MAX];
+            if (!path->empty() && realpath(path->c_str(), resolved))
+                entry.paths.push_back(resolved);
+        }
+        watched.push_back(entry);
+    }
+
+    // starts builds for the files changed since the last call and swaps in the builds that are done. Call once per
+    // frame on the GL thread, before anything is drawn.
+    void Update()
+    {
+        for (const std::string &path : watcher.Poll())
+        {
+            for (Watched &entry : watched)
+            {
+                for (const std::string &source : entry.paths)
+                {
+                    if (source != path)
+                        continue;
+                    if (entry.build.program != 0)
+                        entry.dirty = true;
+                    else
+                        start(entry);
+                    break;
+                }
+            }
+        }
+
+        for (Watched &entry : watched)
+        {
+            if (entry.build.program == 0 || !Shader::BuildReady(entry.build))
+                continue;
+            if (entry.shader->FinishBuild(entry.build))
+                std::cout << "SHADER_RELOADER:: reloaded " << entry.shader->vertexPath << " / " << entry.shader->fragmentPath << std::endl;
+            else
+                std::cout << "WARNING::SHADER_RELOADER:: " << entry.shader->vertexPath << " / " << entry.shader->fragmentPath
+                          << " failed to build, keeping the previous program" << std::endl;
+            if (entry.dirty)
+                start(entry);
+        }
+    }
+
+private:
+    struct Watched {
+        Shader *shader = nullptr;
+        std::vector<std::string> paths; // canonical
+        ShaderBuild build;              // in flight, program 0 when none
+        bool dirty = false;             // changed again while building
+    };
+
+    AssetWatcher watcher;
+    std::vector<Watched> watched;
+
+    void start(Watched &entry)
+    {
+        entry.dirty = false;
+        entry.build = entry.shader->BeginBuild();
+    }
+};
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef TEXTURE_BAKER_H
+#define TEXTURE_BAKER_H
+
+#include <stb_image.h>
+
+#include <learnopengl/image_kernels.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Offline texture baking: JPEG/PNG sources are turned into block compressed DDS files (BC1 for RGB, BC3 for RGBA)
+// holding the whole mip chain, written next to the source as "<image>.dds", or "<image>.srgb.dds" for color maps
+// whose mips are filtered in linear space (see DownsampleImage). The runtime only reads the bake made the way it
+// would build the mips itself. Nothing in here touches OpenGL, the texture_baker tool uses it without a context and
+// the runtime only parses the result (see texture_loader.h).
+
+// the GL enums of EXT_texture_compression_s3tc, kept as plain numbers so this header needs no GL
+const uint32_t BAKED_FORMAT_BC1 = 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+const uint32_t BAKED_FORMAT_BC3 = 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+
+// one mip level inside a buffer holding a whole chain
+struct TextureLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+struct BakedTextureInfo {
+    uint32_t format = 0;
+    std::vector<TextureLevel> levels;
+};
+
+inline std::string BakedTexturePath(const std::string &sourcePath, bool srgb)
+{
+    return sourcePath + (srgb ? ".srgb.dds" : ".dds");
+}
+
+// a baked texture is only used while it is at least as new as its source
+inline bool BakedTextureIsFresh(const std::string &sourcePath, bool srgb)
+{
+    struct stat source, baked;
+    if (stat(BakedTexturePath(sourcePath, srgb).c_str(), &baked) != 0)
+        return false;
+    if (stat(sourcePath.c_str(), &source) != 0)
+        return true;
+    return baked.st_mtime >= source.st_mtime;
+}
+
+// DDS container
+// -------------
+const uint32_t DDS_MAGIC       = 0x20534444; // "DDS "
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844; // "DXT1"
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844; // "DXT5"
+
+struct DdsHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    // DDS_PIXELFORMAT
+    uint32_t pfSize;
+    uint32_t pfFlags;
+    uint32_t pfFourCC;
+    uint32_t pfRGBBitCount;
+    uint32_t pfMasks[4];
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+inline size_t BlockBytes(uint32_t format)
+{
+    return format == BAKED_FORMAT_BC1 ? 8 : 16;
+}
+
+inline size_t CompressedLevelSize(uint32_t format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+// validates a DDS file produced by BakeTexture and locates its mip levels
+inline bool ParseDds(const unsigned char *data, size_t size, BakedTextureInfo &info)
+{
+    if (size < sizeof(DdsHeader))
+        return false;
+    DdsHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != DDS_MAGIC || header.size != 124 || header.pfSize != 32)
+        return false;
+    if (header.pfFourCC == DDS_FOURCC_DXT1)
+        info.format = BAKED_FORMAT_BC1;
+    else if (header.pfFourCC == DDS_FOURCC_DXT5)
+        info.format = BAKED_FORMAT_BC3;
+    else
+        return false;
+
+    info.levels.clear();
+    size_t offset = sizeof(DdsHeader);
+    int width = header.width, height = header.height;
+    unsigned int levels = std::max(1u, header.mipMapCount);
+    for (unsigned int i = 0; i < levels; i++)
+    {
+        TextureLevel level;
+        level.width = width;
+        level.height = height;
+        level.offset = offset;
+        level.size = CompressedLevelSize(info.format, width, height);
+        if (level.size > size - offset)
+            return false;
+        info.levels.push_back(level);
+        offset += level.size;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return true;
+}
+
+// block compression
+// -----------------
+inline uint16_t PackRGB565(const float color[3])
+{
+    int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void UnpackRGB565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block from 16 RGBA pixels. The endpoints sit on the principal axis of the block's colors,
+// always ordered color0 > color1 so the block decodes in four color mode (as BC3 requires).
+inline void CompressColorBlock(const unsigned char pixels[64], unsigned char out[8])
+{
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += pixels[i * 4 + c] / 16.0f;
+
+    float cov[6] = {0, 0, 0, 0, 0, 0}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++)
+    {
+        float r = pixels[i * 4] - mean[0], g = pixels[i * 4 + 1] - mean[1], b = pixels[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    // a few power iterations are plenty to find the dominant direction
+    float axis[3] = {1, 1, 1};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length < 1e-6f)
+            break;
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+    float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float minT = 0, maxT = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = ((pixels[i * 4] - mean[0]) * axis[0] + (pixels[i * 4 + 1] - mean[1]) * axis[1] +
+                   (pixels[i * 4 + 2] - mean[2]) * axis[2]) / axisLength2;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++)
+    {
+        high[c] = mean[c] + axis[c] * maxT;
+        low[c] = mean[c] + axis[c] * minT;
+    }
+    uint16_t color0 = PackRGB565(high), color1 = PackRGB565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = pixels[i * 4] - palette[p][0], dg = pixels[i * 4 + 1] - palette[p][1], db = pixels[i * 4 + 2] - palette[p][2];
+                int distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = color0 & 0xff; out[1] = color0 >> 8;
+    out[2] = color1 & 0xff; out[3] = color1 >> 8;
+    out[4] = indices & 0xff; out[5] = (indices >> 8) & 0xff;
+    out[6] = (indices >> 16) & 0xff; out[7] = indices >> 24;
+}
+
+// BC3 alpha block, eight value mode between the block's minimum and maximum alpha
+inline void CompressAlphaBlock(const unsigned char pixels[64], unsigned char out[8])
+{
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, (int)pixels[i * 4 + 3]);
+        alpha1 = std::min(alpha1, (int)pixels[i * 4 + 3]);
+    }
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int distance = std::abs(pixels[i * 4 + 3] - palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    out[0] = (unsigned char)alpha0;
+    out[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+// compresses one RGBA8 image, blocks past the right or bottom edge repeat the edge pixels
+inline void CompressImage(const unsigned char *rgba, int width, int height, uint32_t format, unsigned char *out)
+{
+    unsigned char block[64];
+    for (int by = 0; by < height; by += 4)
+    {
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                    memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)std::min(by + y, height - 1) * width + std::min(bx + x, width - 1)) * 4, 4);
+            if (format == BAKED_FORMAT_BC3)
+            {
+                CompressAlphaBlock(block, out);
+                out += 8;
+            }
+            CompressColorBlock(block, out);
+            out += 8;
+        }
+    }
+}
+
+// bakes sourcePath into BakedTexturePath(sourcePath, srgb), with the mips filtered in linear space when srgb is set
+// (color maps). Only RGB and RGBA images are baked, the rest keep loading from their source. Rows are stored in the
+// order stb_image decodes them, exactly like the uncompressed upload.
+inline bool BakeTexture(const std::string &sourcePath, bool srgb)
+{
+    int width, height, components;
+    unsigned char *data = stbi_load(sourcePath.c_str(), &width, &height, &components, 4);
+    if (!data)
+        return false;
+    if (components != 3 && components != 4)
+    {
+        stbi_image_free(data);
+        return false;
+    }
+    std::vector<unsigned char> level(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    uint32_t format = components == 4 ? BAKED_FORMAT_BC3 : BAKED_FORMAT_BC1;
+    std::vector<unsigned char> payload;
+    unsigned int levels = 0;
+    int levelWidth = width, levelHeight = height;
+    for (;;)
+    {
+        size_t offset = payload.size();
+        payload.resize(offset + CompressedLevelSize(format, levelWidth, levelHeight));
+        CompressImage(level.data(), levelWidth, levelHeight, format, payload.data() + offset);
+        levels++;
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+        std::vector<unsigned char> next((size_t)MipDimension(levelWidth) * MipDimension(levelHeight) * 4);
+        DownsampleImage(level.data(), levelWidth, levelHeight, 4, srgb, next.data());
+        level.swap(next);
+        levelWidth = MipDimension(levelWidth);
+        levelHeight = MipDimension(levelHeight);
+    }
+
+    DdsHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DDS_MAGIC;
+    header.size = 124;
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+    header.height = height;
+    header.width = width;
+    header.pitchOrLinearSize = CompressedLevelSize(format, width, height);
+    header.mipMapCount = levels;
+    header.pfSize = 32;
+    header.pfFlags = 0x4; // fourCC
+    header.pfFourCC = format == BAKED_FORMAT_BC3 ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+    header.caps = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+
+    std::string targetPath = BakedTexturePath(sourcePath, srgb);
+    std::string tempPath = targetPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)payload.data(), payload.size());
+    out.close();
+    if (!out)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return rename(tempPath.c_str(), targetPath.c_str()) == 0;
+}
+
+#endif
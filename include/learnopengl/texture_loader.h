@@ -0,0 +1,805 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/cubemap_pack.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/image_kernels.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_baker.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// an image file decoded on the CPU, waiting to be uploaded on the GL thread. pixels holds every level listed in
+// levels, either 8 bit pixels (rows tightly packed, RGB is expanded to RGBA) or the block compressed chain of a
+// baked texture (see texture_baker.h), in which case compressedFormat is its GL format. A failed load has no levels.
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    uint32_t compressedFormat = 0;
+    std::vector<unsigned char> pixels;
+    std::vector<TextureLevel> levels;
+};
+
+// decodes an image file, safe to call from any thread. The flip is applied here instead of through
+// stbi_set_flip_vertically_on_load, which is process global and would race between parallel decodes.
+// With generateMips the whole mip chain is built as well, filtered in linear space when srgb is set.
+inline DecodedImage DecodeImage(const std::string &filename, bool flipVertically = false, bool generateMips = false, bool srgb = false)
+{
+    DecodedImage image;
+    int components;
+    unsigned char *data = stbi_load(filename.c_str(), &image.width, &image.height, &components, 0);
+    if (!data)
+    {
+        std::cout << "Texture failed to load at path: " << filename << std::endl;
+        return image;
+    }
+    image.components = components == 3 ? 4 : components;
+
+    // lay the chain out first so the levels are written in place
+    int width = image.width, height = image.height;
+    size_t offset = 0;
+    for (;;)
+    {
+        TextureLevel level = {width, height, offset, (size_t)width * height * image.components};
+        image.levels.push_back(level);
+        offset += level.size;
+        if (!generateMips || (width == 1 && height == 1))
+            break;
+        width = MipDimension(width);
+        height = MipDimension(height);
+    }
+    image.pixels.resize(offset);
+
+    const ImageKernels &kernels = BestImageKernels();
+    if (components == 3)
+        kernels.expandRGBToRGBA(data, image.pixels.data(), (size_t)image.width * image.height);
+    else
+        memcpy(image.pixels.data(), data, image.levels[0].size);
+    stbi_image_free(data);
+    if (flipVertically)
+        kernels.flipRows(image.pixels.data(), (size_t)image.width * image.components, image.height);
+
+    for (unsigned int i = 1; i < image.levels.size(); i++)
+    {
+        const TextureLevel &previous = image.levels[i - 1];
+        DownsampleImage(image.pixels.data() + previous.offset, previous.width, previous.height, image.components, srgb,
+                        image.pixels.data() + image.levels[i].offset);
+    }
+    return image;
+}
+
+// the fresh baked DDS of a texture, mapped so that only the levels wanted are read out of it
+struct BakedImageFile {
+    MappedFile file;
+    BakedTextureInfo info;
+
+    // false if there is no bake whose mips were filtered like srgb asks, or it is unusable
+    bool Open(const std::string &filename, bool srgb)
+    {
+        return BakedTextureIsFresh(filename, srgb) && file.open(BakedTexturePath(filename, srgb)) && ParseDds(file.data, file.size, info);
+    }
+
+    // copies the levels from first on into image, first becoming its level 0
+    void Read(DecodedImage &image, unsigned int first) const
+    {
+        first = std::min<unsigned int>(first, info.levels.size() - 1);
+        size_t offset = info.levels[first].offset;
+        const TextureLevel &last = info.levels.back();
+        image.pixels.assign(file.data + offset, file.data + last.offset + last.size);
+        image.levels.assign(info.levels.begin() + first, info.levels.end());
+        for (TextureLevel &level : image.levels)
+            level.offset -= offset;
+        image.compressedFormat = info.format;
+        image.width = image.levels[0].width;
+        image.height = image.levels[0].height;
+        image.components = info.format == BAKED_FORMAT_BC3 ? 4 : 3;
+    }
+};
+
+// reads the whole chain of the fresh baked DDS of filename whose mips were filtered like srgb asks, returns false if
+// there is none or it is unusable
+inline bool ReadBakedImage(const std::string &filename, DecodedImage &image, bool srgb)
+{
+    BakedImageFile baked;
+    if (!baked.Open(filename, srgb))
+        return false;
+    baked.Read(image, 0);
+    return true;
+}
+
+// decodes a 2D texture with its mip chain, preferring its baked version when useBaked is set. Baked textures are
+// stored unflipped, so a flipped load always decodes the source. useBaked should come from CompressedTexturesSupported().
+inline DecodedImage DecodeTexture(const std::string &filename, bool flipVertically, bool useBaked, bool srgb = false)
+{
+    DecodedImage image;
+    if (useBaked && !flipVertically && ReadBakedImage(filename, image, srgb))
+        return image;
+    return DecodeImage(filename, flipVertically, true, srgb);
+}
+
+inline GLenum ImageFormat(int components)
+{
+    if (components == 1)
+        return GL_RED;
+    if (components == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+inline GLenum ImageFormat(const DecodedImage &image)
+{
+    return ImageFormat(image.components);
+}
+
+inline void UploadLevel(GLenum target, unsigned int index, GLenum internalFormat, const DecodedImage &image)
+{
+    const TextureLevel &level = image.levels[index];
+    const unsigned char *data = image.pixels.data() + level.offset;
+    if (image.compressedFormat)
+    {
+        glCompressedTexImage2D(target, index, image.compressedFormat, level.width, level.height, 0, level.size, data);
+    }
+    else
+    {
+        // rows are tightly packed, which only matches the default alignment of 4 for RGBA
+        if (image.components != 4)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(target, index, internalFormat, level.width, level.height, 0, ImageFormat(image), GL_UNSIGNED_BYTE, data);
+        if (image.components != 4)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+}
+
+// uploads a decoded image into an existing 2D texture and frees it. Must be called on the GL thread.
+inline void UploadImage(unsigned int textureID, DecodedImage &image)
+{
+    if (image.levels.empty())
+        return;
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    for (unsigned int i = 0; i < image.levels.size(); i++)
+        UploadLevel(GL_TEXTURE_2D, i, ImageFormat(image), image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+    // only an image decoded without its chain still needs the driver to build it
+    if (image.levels.size() == 1 && !image.compressedFormat)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    std::vector<unsigned char>().swap(image.pixels);
+}
+
+// drops the levels before first from a decoded chain, so first becomes level 0
+inline void DropLeadingLevels(DecodedImage &image, unsigned int first)
+{
+    if (first == 0 || first >= image.levels.size())
+        return;
+    size_t offset = image.levels[first].offset;
+    image.pixels.erase(image.pixels.begin(), image.pixels.begin() + offset);
+    image.pixels.shrink_to_fit();
+    image.levels.erase(image.levels.begin(), image.levels.begin() + first);
+    for (TextureLevel &level : image.levels)
+        level.offset -= offset;
+    image.width = image.levels[0].width;
+    image.height = image.levels[0].height;
+}
+
+// synchronous load of a 2D texture file into an existing texture name, baked when possible. GL thread only.
+inline void LoadTextureFile(unsigned int textureID, const std::string &filename, bool flipVertically = false, bool srgb = false)
+{
+    DecodedImage image = DecodeTexture(filename, flipVertically, CompressedTexturesSupported(), srgb);
+    UploadImage(textureID, image);
+}
+
+inline void SetCubemapParameters(GLenum minFilter)
+{
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+// uploads the six decoded faces (+X, -X, +Y, -Y, +Z, -Z) into an existing cubemap and frees them. The cubemap
+// is not mipmapped, baked faces only upload their first level. All faces need the same format to be complete.
+inline void UploadCubemap(unsigned int textureID, std::vector<DecodedImage> &faces)
+{
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        if (faces[i].levels.empty())
+            continue;
+        UploadLevel(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, faces[i]);
+        std::vector<unsigned char>().swap(faces[i].pixels);
+    }
+    SetCubemapParameters(GL_LINEAR);
+}
+
+// uploads the packed version of a cubemap (see cubemap_pack.h) with all its mips, straight from one mapping of
+// the file. Returns false when there is no valid pack for these faces. GL thread only.
+inline bool UploadCubemapPack(unsigned int textureID, const std::vector<std::string> &faces)
+{
+    CubemapPack pack;
+    if (!pack.Open(faces))
+        return false;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    for (unsigned int face = 0; face < 6; face++)
+    {
+        for (unsigned int level = 0; level < pack.header.levelCount; level++)
+        {
+            int size = pack.LevelSize(level);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pack.Level(face, level));
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, pack.header.levelCount - 1);
+    SetCubemapParameters(GL_LINEAR_MIPMAP_LINEAR);
+    return true;
+}
+
+// the bake cubemap faces are read from. Only their first level is uploaded, which both bakes share; faces are color
+// images, which the texture_baker tool bakes as sRGB.
+const bool CUBEMAP_FACE_SRGB = true;
+
+// how a 2D texture is loaded
+struct TextureOptions {
+    bool flipVertically = false;
+    // filter the mips in linear space, right for color maps but not for data like normal maps
+    bool srgb = false;
+    // stream the mips by demand when the loader streams, see TextureLoader
+    bool streamed = false;
+};
+
+// textures stream in as a mip tail no larger than this, and never drop below it
+const int STREAM_TAIL_SIZE = 64;
+// seconds a streamed texture has to want fewer mips before they are dropped
+const double STREAM_DROP_DELAY = 3.0;
+
+// Asynchronous texture loading. Load() hands out a texture name right away, backed by a 1x1 white placeholder,
+// and decodes the file on the thread pool. Update() uploads finished images on the GL thread, spending at most
+// the given time budget per call, so a frame never stalls behind a large upload. Textures with a fresh baked
+// version are read from it and uploaded compressed with their precomputed mips when the driver supports S3TC.
+//
+// With streaming enabled, textures loaded as streamed only upload their mip tail at first. Every frame the renderer
+// reports through RequestDetail() how many texels across each texture covers on screen, and Update() makes the level
+// that covers it the finest one resident. More detail is read again on the pool right away, only the levels needed
+// out of the mapped bake or else by decoding the source. Less detail is dropped after STREAM_DROP_DELAY without
+// touching the file: the texture is specified again from the levels it keeps, copied on the GPU. The GL texture
+// always holds just the resident levels, its level 0 being the finest one, so dropped mips really free their memory.
+class TextureLoader
+{
+public:
+    explicit TextureLoader(ThreadPool &pool) : pool(pool), inFlight(0), useBaked(CompressedTexturesSupported()), streaming(false)
+    {
+    }
+
+    ~TextureLoader()
+    {
+        // decodes still running write into our queue, wait for them before going away
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return inFlight == 0; });
+    }
+
+    TextureLoader(const TextureLoader &) = delete;
+    TextureLoader &operator=(const TextureLoader &) = delete;
+
+    // honor TextureOptions::streamed for the textures loaded from now on
+    void EnableStreaming(bool enable)
+    {
+        streaming = enable;
+    }
+
+    // 2D texture, repeating and mipmapped like TextureFromFile. The mip chain is built on the worker.
+    unsigned int Load(const std::string &path, const TextureOptions &options = TextureOptions())
+    {
+        unsigned int id = createPlaceholder(GL_TEXTURE_2D);
+        if (streaming && options.streamed)
+        {
+            StreamedTexture &texture = streamed[id];
+            texture.path = path;
+            texture.options = options;
+            texture.busy = true;
+        }
+        submit2D(id, path, options, streaming && options.streamed, -1, 0);
+        return id;
+    }
+
+    // cubemap from six face images in +X, -X, +Y, -Y, +Z, -Z order. A fresh pack of the faces is uploaded right away
+    // from its mapping, otherwise the faces decode in parallel and are uploaded together.
+    unsigned int LoadCubemap(const std::vector<std::string> &faces, bool flipVertically = false)
+    {
+        // packs are stored unflipped
+        if (!flipVertically && CubemapPackIsFresh(faces))
+        {
+            unsigned int textureID;
+            glGenTextures(1, &textureID);
+            if (UploadCubemapPack(textureID, faces))
+                return textureID;
+            glDeleteTextures(1, &textureID);
+        }
+        std::shared_ptr<Request> request = std::make_shared<Request>();
+        request->target = GL_TEXTURE_CUBE_MAP;
+        request->paths = faces;
+        request->options.flipVertically = flipVertically;
+        // mixing compressed and uncompressed faces would leave the cubemap incomplete, so it is all or nothing
+        request->useBaked = useBaked;
+        for (const std::string &face : faces)
+            request->useBaked = request->useBaked && BakedTextureIsFresh(face, CUBEMAP_FACE_SRGB);
+        request->id = createPlaceholder(GL_TEXTURE_CUBE_MAP);
+        submit(request);
+        return request->id;
+    }
+
+    // the texture covers about texels texels across on screen this frame. Ignored for textures that do not stream.
+    void RequestDetail(unsigned int id, float texels)
+    {
+        std::unordered_map<unsigned int, StreamedTexture>::iterator it = streamed.find(id);
+        if (it != streamed.end())
+            it->second.demand = std::max(it->second.demand, texels);
+    }
+
+    // decodes path again into a texture handed out by Load, for a file that changed on disk. The texture keeps its
+    // name and shows the old image until the new one is uploaded by Update, so whoever holds it sees the swap between
+    // two frames.
+    void Reload(unsigned int id, const std::string &path, const TextureOptions &options)
+    {
+        std::unordered_map<unsigned int, StreamedTexture>::iterator it = streamed.find(id);
+        if (it == streamed.end())
+        {
+            submit2D(id, path, options, false, 0, 0);
+            return;
+        }
+        // the size may have changed, start over from the tail like a fresh load. A decode still on its way is of the
+        // old file and dropped when it arrives.
+        StreamedTexture &texture = it->second;
+        texture.path = path;
+        texture.options = options;
+        texture.levelCount = 0;
+        texture.far = false;
+        texture.generation++;
+        submitStream(id, texture, -1);
+    }
+
+    // streams a texture from path from now on, for a byte identical copy of the file it was loaded from that stays
+    // while the old one changes (see TextureRegistry::Reload)
+    void Repath(unsigned int id, const std::string &path)
+    {
+        std::unordered_map<unsigned int, StreamedTexture>::iterator it = streamed.find(id);
+        if (it == streamed.end() || it->second.path == path)
+            return;
+        StreamedTexture &texture = it->second;
+        texture.path = path;
+        // a decode on its way may have read the old file after it changed, do it again
+        if (texture.busy)
+        {
+            texture.generation++;
+            submitStream(id, texture, texture.requestedLevel);
+        }
+    }
+
+    // stops streaming a texture that is about to be deleted
+    void Forget(unsigned int id)
+    {
+        streamed.erase(id);
+    }
+
+    // starts the streaming decided by the detail requested since the last call, then uploads decoded textures
+    // until budgetMs is used up, at least one per call. Call once per frame on the GL thread.
+    void Update(double budgetMs)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        updateStreaming(start);
+        for (;;)
+        {
+            std::shared_ptr<Request> request;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ready.empty())
+                    return;
+                request = ready.front();
+                ready.pop_front();
+            }
+            upload(*request);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetMs)
+                return;
+        }
+    }
+
+    // blocks until every requested texture is uploaded
+    void Finish()
+    {
+        for (;;)
+        {
+            std::shared_ptr<Request> request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                idle.wait(lock, [this]() { return inFlight == 0 || !ready.empty(); });
+                if (ready.empty())
+                    return;
+                request = ready.front();
+                ready.pop_front();
+            }
+            upload(*request);
+        }
+    }
+
+    // textures handed out whose pixels are not on the GPU yet, streaming included
+    unsigned int Pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inFlight + ready.size();
+    }
+
+    // GPU memory held by the levels of streamed textures
+    size_t StreamedBytes() const
+    {
+        size_t bytes = 0;
+        for (const std::pair<const unsigned int, StreamedTexture> &texture : streamed)
+            bytes += texture.second.residentBytes;
+        return bytes;
+    }
+
+private:
+    struct Request {
+        unsigned int id = 0;
+        GLenum target = GL_TEXTURE_2D;
+        TextureOptions options;
+        bool useBaked = false;
+        bool streamed = false;
+        // first chain level to upload, -1 for the streaming tail
+        int firstLevel = 0;
+        // of the streamed texture when it was submitted
+        unsigned int generation = 0;
+        // the full chain, filled by the decode of a streamed texture
+        int width = 0;
+        int height = 0;
+        unsigned int levelCount = 0;
+        unsigned int tailLevel = 0;
+        std::vector<std::string> paths;
+        std::vector<DecodedImage> images;
+        std::atomic<unsigned int> remaining{0};
+    };
+
+    // GL thread state of a streamed texture
+    struct StreamedTexture {
+        std::string path;
+        TextureOptions options;
+        int width = 0;
+        int height = 0;
+        unsigned int levelCount = 0; // 0 until the first decode
+        unsigned int tailLevel = 0;
+        unsigned int residentLevel = 0; // first chain level on the GPU
+        unsigned int residentCount = 0; // levels the GL texture holds
+        size_t residentBytes = 0;
+        uint32_t compressedFormat = 0; // of the resident levels, as in DecodedImage
+        int components = 0;
+        float demand = 0.0f;
+        bool busy = false; // a decode is on its way
+        int requestedLevel = -1; // the level it was asked for
+        // counts the reloads, a decode submitted before the last one is stale
+        unsigned int generation = 0;
+        bool far = false;
+        std::chrono::steady_clock::time_point farSince;
+    };
+
+    ThreadPool &pool;
+    std::deque<std::shared_ptr<Request>> ready;
+    unsigned int inFlight;
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    const bool useBaked;
+    bool streaming;
+    std::unordered_map<unsigned int, StreamedTexture> streamed;
+
+    static unsigned int createPlaceholder(GLenum target)
+    {
+        static const unsigned char white[4] = {255, 255, 255, 255};
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(target, textureID);
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            for (unsigned int i = 0; i < 6; i++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        }
+        else
+        {
+            glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        }
+        // a single 1x1 level is a complete mip chain, so any filter works until the real image arrives
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
+    // first level of a chain no larger than STREAM_TAIL_SIZE
+    static unsigned int findTailLevel(const std::vector<TextureLevel> &levels)
+    {
+        unsigned int level = 0;
+        while (level + 1 < levels.size() && std::max(levels[level].width, levels[level].height) > STREAM_TAIL_SIZE)
+            level++;
+        return level;
+    }
+
+    void submit2D(unsigned int id, const std::string &path, const TextureOptions &options, bool streamed, int firstLevel, unsigned int generation)
+    {
+        std::shared_ptr<Request> request = std::make_shared<Request>();
+        request->id = id;
+        request->target = GL_TEXTURE_2D;
+        request->paths.push_back(path);
+        request->options = options;
+        request->useBaked = useBaked;
+        request->streamed = streamed;
+        request->firstLevel = streamed ? firstLevel : 0;
+        request->generation = generation;
+        submit(request);
+    }
+
+    void submitStream(unsigned int id, StreamedTexture &texture, int firstLevel)
+    {
+        texture.busy = true;
+        texture.requestedLevel = firstLevel;
+        submit2D(id, texture.path, texture.options, true, firstLevel, texture.generation);
+    }
+
+    void submit(const std::shared_ptr<Request> &request)
+    {
+        request->images.resize(request->paths.size());
+        request->remaining = request->paths.size();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight++;
+        }
+        for (unsigned int i = 0; i < request->paths.size(); i++)
+        {
+            pool.Enqueue([this, request, i]() {
+                decode(*request, i);
+                if (--request->remaining == 0)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    inFlight--;
+                    ready.push_back(request);
+                    idle.notify_all();
+                }
+            });
+        }
+    }
+
+    // runs on the pool
+    static void decode(Request &request, unsigned int i)
+    {
+        DecodedImage &image = request.images[i];
+        if (request.target == GL_TEXTURE_CUBE_MAP)
+        {
+            if (!request.useBaked || !ReadBakedImage(request.paths[i], image, CUBEMAP_FACE_SRGB))
+                image = DecodeImage(request.paths[i], request.options.flipVertically); // cubemaps have no mips
+            return;
+        }
+        if (!request.streamed)
+        {
+            image = DecodeTexture(request.paths[i], request.options.flipVertically, request.useBaked, request.options.srgb);
+            return;
+        }
+        // a bake is only read from the first level uploaded on, a source has to be decoded whole
+        BakedImageFile baked;
+        bool fromBake = request.useBaked && !request.options.flipVertically && baked.Open(request.paths[i], request.options.srgb);
+        if (!fromBake)
+            image = DecodeImage(request.paths[i], request.options.flipVertically, true, request.options.srgb);
+        const std::vector<TextureLevel> &chain = fromBake ? baked.info.levels : image.levels;
+        if (chain.empty())
+            return;
+        request.width = chain[0].width;
+        request.height = chain[0].height;
+        request.levelCount = chain.size();
+        request.tailLevel = findTailLevel(chain);
+        unsigned int first = request.firstLevel < 0 ? request.tailLevel : request.firstLevel;
+        request.firstLevel = std::min<unsigned int>(first, chain.size() - 1);
+        // the levels above the resident ones are not kept around until the upload
+        if (fromBake)
+            baked.Read(image, request.firstLevel);
+        else
+            DropLeadingLevels(image, request.firstLevel);
+    }
+
+    void upload(Request &request)
+    {
+        if (request.target == GL_TEXTURE_CUBE_MAP)
+        {
+            // a baked face that failed to read leaves the others no choice but to use their sources too
+            bool mixed = false;
+            for (DecodedImage &image : request.images)
+                mixed = mixed || (image.compressedFormat != 0) != (request.images[0].compressedFormat != 0);
+            for (unsigned int i = 0; mixed && i < request.images.size(); i++)
+                if (request.images[i].compressedFormat)
+                    request.images[i] = DecodeImage(request.paths[i], request.options.flipVertically);
+            UploadCubemap(request.id, request.images);
+            return;
+        }
+
+        if (!request.streamed)
+        {
+            UploadImage(request.id, request.images[0]);
+            return;
+        }
+        std::unordered_map<unsigned int, StreamedTexture>::iterator it = streamed.find(request.id);
+        if (it == streamed.end())
+            return; // forgotten while the decode ran
+        StreamedTexture &texture = it->second;
+        if (request.generation != texture.generation)
+            return; // reloaded while the decode ran, the newer decode is still to come
+        texture.busy = false;
+        DecodedImage &image = request.images[0];
+        if (image.levels.empty())
+            return;
+        texture.width = request.width;
+        texture.height = request.height;
+        texture.levelCount = request.levelCount;
+        texture.residentLevel = request.firstLevel;
+        texture.residentBytes = 0;
+        for (const TextureLevel &level : image.levels)
+            texture.residentBytes += level.size;
+        texture.tailLevel = request.tailLevel;
+        texture.compressedFormat = image.compressedFormat;
+        texture.components = image.components;
+        // a reload may bring a shorter chain
+        unsigned int previousCount = texture.residentCount;
+        texture.residentCount = image.levels.size();
+        UploadImage(request.id, image);
+        releaseLevels(texture.residentCount, previousCount);
+    }
+
+    // empties the levels from first up to end of the bound texture, past its MAX_LEVEL, which would otherwise keep
+    // their memory
+    static void releaseLevels(unsigned int first, unsigned int end)
+    {
+        for (unsigned int level = first; level < end; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    // makes level the finest resident one of a texture that holds it already. The levels kept are copied into a
+    // pixel buffer and the texture is specified again from it, all on the GPU. GL thread only.
+    void dropLevels(unsigned int id, StreamedTexture &texture, unsigned int level)
+    {
+        texture.far = false;
+        std::vector<TextureLevel> kept;
+        size_t bytes = 0;
+        int width = texture.width, height = texture.height;
+        for (unsigned int i = 0; i < texture.levelCount; i++)
+        {
+            if (i >= level)
+            {
+                size_t size = texture.compressedFormat ? CompressedLevelSize(texture.compressedFormat, width, height)
+                                                       : (size_t)width * height * texture.components;
+                TextureLevel chainLevel = {width, height, bytes, size};
+                kept.push_back(chainLevel);
+                bytes += size;
+            }
+            width = MipDimension(width);
+            height = MipDimension(height);
+        }
+        unsigned int dropped = level - texture.residentLevel;
+        GLenum format = ImageFormat(texture.components);
+
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_COPY);
+        glBindTexture(GL_TEXTURE_2D, id);
+        // rows are tightly packed, which only matches the default alignment of 4 for RGBA
+        if (texture.components != 4)
+        {
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        }
+        for (unsigned int i = 0; i < kept.size(); i++)
+        {
+            void *offset = (void *)kept[i].offset;
+            if (texture.compressedFormat)
+                glGetCompressedTexImage(GL_TEXTURE_2D, dropped + i, offset);
+            else
+                glGetTexImage(GL_TEXTURE_2D, dropped + i, format, GL_UNSIGNED_BYTE, offset);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        for (unsigned int i = 0; i < kept.size(); i++)
+        {
+            const TextureLevel &chainLevel = kept[i];
+            void *offset = (void *)chainLevel.offset;
+            if (texture.compressedFormat)
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, texture.compressedFormat, chainLevel.width, chainLevel.height, 0, chainLevel.size, offset);
+            else
+                glTexImage2D(GL_TEXTURE_2D, i, format, chainLevel.width, chainLevel.height, 0, format, GL_UNSIGNED_BYTE, offset);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (texture.components != 4)
+        {
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, kept.size() - 1);
+        releaseLevels(kept.size(), texture.residentCount);
+        glDeleteBuffers(1, &buffer);
+
+        texture.residentLevel = level;
+        texture.residentCount = kept.size();
+        texture.residentBytes = bytes;
+    }
+
+    // finest chain level the texture needs for its demand
+    static unsigned int wantedLevel(const StreamedTexture &texture)
+    {
+        unsigned int level = 0;
+        int size = std::max(texture.width, texture.height);
+        while (level < texture.tailLevel && MipDimension(size) >= texture.demand)
+        {
+            size = MipDimension(size);
+            level++;
+        }
+        return level;
+    }
+
+    void updateStreaming(std::chrono::steady_clock::time_point now)
+    {
+        for (std::pair<const unsigned int, StreamedTexture> &entry : streamed)
+        {
+            StreamedTexture &texture = entry.second;
+            if (texture.busy || texture.levelCount == 0)
+            {
+                texture.demand = 0.0f;
+                continue;
+            }
+            unsigned int wanted = wantedLevel(texture);
+            texture.demand = 0.0f;
+            if (wanted < texture.residentLevel)
+            {
+                stream(entry.first, texture, wanted);
+            }
+            else if (wanted > texture.residentLevel)
+            {
+                // only drop detail that has not been needed for a while, so nothing thrashes at a level boundary
+                if (!texture.far)
+                {
+                    texture.far = true;
+                    texture.farSince = now;
+                }
+                else if (std::chrono::duration<double>(now - texture.farSince).count() >= STREAM_DROP_DELAY)
+                {
+                    dropLevels(entry.first, texture, wanted);
+                }
+            }
+            else
+            {
+                texture.far = false;
+            }
+        }
+    }
+
+    void stream(unsigned int id, StreamedTexture &texture, unsigned int level)
+    {
+        texture.far = false;
+        submitStream(id, texture, level);
+    }
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_baker.h>
+#include <learnopengl/texture_loader.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a texture shared by byte identical files that one of them left when it changed, see TextureRegistry::Reload
+struct TextureSplit {
+    unsigned int from; // the texture the other files keep
+    unsigned int to;   // the texture of the changed file from now on
+    std::string path;  // canonical path of the changed file
+};
+
+// Process wide registry of 2D textures loaded from files. A file is looked up first by its canonical path and then
+// by a hash of its bytes, so every model shares one GL texture per image, including byte identical copies stored
+// under different names. Textures are reference counted and their GPU memory is accounted from the image header,
+// before the pixels are even decoded. Only use it from the GL thread.
+
+class TextureRegistry
+{
+public:
+    static TextureRegistry &Instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // returns the texture for path, loading it (asynchronously when a loader is given) if nobody holds it yet
+    unsigned int Acquire(const std::string &path, TextureLoader *textureLoader = nullptr, const TextureOptions &options = TextureOptions())
+    {
+        std::string canonical = CanonicalPath(path);
+        // the same file loaded with other options is another texture
+        bool streamed = textureLoader && options.streamed;
+        std::string key = canonical + (options.flipVertically ? "|flip" : "") + (options.srgb ? "|srgb" : "") + (streamed ? "|stream" : "");
+        std::unordered_map<std::string, unsigned int>::iterator byPathIt = byPath.find(key);
+        if (byPathIt != byPath.end())
+        {
+            findPath(entries[byPathIt->second], canonical)->references++;
+            return addRef(byPathIt->second);
+        }
+
+        // an unknown path can still be a copy of an image we already have
+        MappedFile file(canonical);
+        uint64_t contentHash = 0;
+        if (file.isOpen())
+        {
+            contentHash = contentKey(file, options, streamed);
+            std::unordered_map<uint64_t, unsigned int>::iterator byContentIt = byContent.find(contentHash);
+            if (byContentIt != byContent.end())
+            {
+                byPath[key] = byContentIt->second;
+                entries[byContentIt->second].paths.push_back({key, canonical, 1});
+                return addRef(byContentIt->second);
+            }
+        }
+
+        unsigned int id;
+        if (textureLoader)
+        {
+            id = textureLoader->Load(canonical, options);
+        }
+        else
+        {
+            glGenTextures(1, &id);
+            LoadTextureFile(id, canonical, options.flipVertically, options.srgb);
+        }
+
+        Entry &entry = entries[id];
+        entry.references = 1;
+        entry.contentHash = contentHash;
+        entry.options = options;
+        entry.loadedBy = textureLoader;
+        entry.streamedBy = streamed ? textureLoader : nullptr;
+        entry.gpuBytes = file.isOpen() ? estimateGpuBytes(file, canonical, options) : 0;
+        entry.paths.push_back({key, canonical, 1});
+        byPath[key] = id;
+        if (file.isOpen())
+            byContent[contentHash] = id;
+        gpuBytes += entry.gpuBytes;
+        return id;
+    }
+
+    // drops one reference taken through path (as given to Acquire, any of the texture's paths when empty), the texture
+    // is deleted with the last one
+    void Release(unsigned int id, const std::string &path = std::string())
+    {
+        std::unordered_map<unsigned int, Entry>::iterator it = entries.find(id);
+        if (it == entries.end())
+            return;
+        Entry &entry = it->second;
+        std::vector<PathUse>::iterator use = path.empty() ? entry.paths.begin() : findPath(entry, CanonicalPath(path));
+        if (use != entry.paths.end() && --use->references == 0)
+        {
+            byPath.erase(use->key);
+            entry.paths.erase(use);
+            // a streamed texture decodes its file again and again, keep it on one that is still in use
+            if (entry.streamedBy && !entry.paths.empty())
+                entry.streamedBy->Repath(id, entry.paths.front().path);
+        }
+        if (--entry.references > 0)
+            return;
+        for (const PathUse &remaining : entry.paths)
+            byPath.erase(remaining.key);
+        if (entry.contentHash != 0)
+            byContent.erase(entry.contentHash);
+        gpuBytes -= entry.gpuBytes;
+        if (entry.streamedBy)
+            entry.streamedBy->Forget(id);
+        entries.erase(it);
+        glDeleteTextures(1, &id);
+    }
+
+    // loads the textures of a file that changed on disk again. A texture loaded through this file only is reloaded in
+    // place: every holder keeps its texture name and sees the new image once it is uploaded (asynchronously when the
+    // texture came from a loader). A texture shared with byte identical files under other paths is split instead: the
+    // changed file gets a texture of its own, reported in splits, and the other files keep theirs untouched. Whoever
+    // acquired the texture through the changed file has to switch to the new name (see Model::RepointTextures), the
+    // references are moved along. Returns whether the file is in use at all.
+    bool Reload(const std::string &path, std::vector<TextureSplit> &splits)
+    {
+        std::string canonical = CanonicalPath(path);
+        // splitting adds entries, so find the ones to reload first
+        std::vector<unsigned int> ids;
+        for (std::pair<const unsigned int, Entry> &it : entries)
+            if (findPath(it.second, canonical) != it.second.paths.end())
+                ids.push_back(it.first);
+
+        for (unsigned int id : ids)
+        {
+            MappedFile file(canonical);
+            if (!file.isOpen())
+                continue;
+            Entry &entry = entries[id];
+            if (entry.paths.size() > 1)
+            {
+                splits.push_back({id, split(id, canonical, file), canonical});
+                continue;
+            }
+
+            // the new bytes are the texture's content key from now on, unless another texture already has them
+            uint64_t contentHash = contentKey(file, entry.options, entry.streamedBy != nullptr);
+            if (entry.contentHash != 0)
+                byContent.erase(entry.contentHash);
+            entry.contentHash = byContent.count(contentHash) ? 0 : contentHash;
+            if (entry.contentHash != 0)
+                byContent[contentHash] = id;
+            gpuBytes -= entry.gpuBytes;
+            entry.gpuBytes = estimateGpuBytes(file, canonical, entry.options);
+            gpuBytes += entry.gpuBytes;
+
+            if (entry.loadedBy)
+                entry.loadedBy->Reload(id, canonical, entry.options);
+            else
+                LoadTextureFile(id, canonical, entry.options.flipVertically, entry.options.srgb);
+        }
+        return !ids.empty();
+    }
+
+    unsigned int Count() const
+    {
+        return entries.size();
+    }
+
+    // with every mip level resident, streamed textures usually hold less (see TextureLoader::StreamedBytes())
+    size_t GpuBytes() const
+    {
+        return gpuBytes;
+    }
+
+    // the path textures are known by, symbolic links and relative parts resolved
+    static std::string CanonicalPath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return std::string(resolved);
+        return path;
+    }
+
+private:
+    // the references a texture got through one of its files
+    struct PathUse {
+        std::string key; // in byPath
+        std::string path; // canonical
+        unsigned int references;
+    };
+
+    struct Entry {
+        unsigned int references = 0;
+        uint64_t contentHash = 0;
+        size_t gpuBytes = 0;
+        TextureOptions options;
+        TextureLoader *loadedBy = nullptr;
+        TextureLoader *streamedBy = nullptr;
+        std::vector<PathUse> paths;
+    };
+
+    std::unordered_map<std::string, unsigned int> byPath;
+    std::unordered_map<uint64_t, unsigned int> byContent;
+    std::unordered_map<unsigned int, Entry> entries;
+    size_t gpuBytes = 0;
+
+    TextureRegistry() {}
+
+    unsigned int addRef(unsigned int id)
+    {
+        entries[id].references++;
+        return id;
+    }
+
+    // the use of the file at canonical, all paths of a texture have the same options
+    static std::vector<PathUse>::iterator findPath(Entry &entry, const std::string &canonical)
+    {
+        return std::find_if(entry.paths.begin(), entry.paths.end(), [&canonical](const PathUse &use) { return use.path == canonical; });
+    }
+
+    // moves the file at canonical, changed on disk, off the texture id into a new texture loaded from it, returns that
+    unsigned int split(unsigned int id, const std::string &canonical, const MappedFile &file)
+    {
+        Entry &shared = entries[id];
+        std::vector<PathUse>::iterator use = findPath(shared, canonical);
+        PathUse moved = *use;
+        shared.paths.erase(use);
+        shared.references -= moved.references;
+        // the other files still hold the old bytes, a streamed texture must not decode the changed one again
+        if (shared.streamedBy)
+            shared.streamedBy->Repath(id, shared.paths.front().path);
+        TextureOptions options = shared.options;
+        TextureLoader *loadedBy = shared.loadedBy, *streamedBy = shared.streamedBy;
+
+        unsigned int to;
+        if (loadedBy)
+        {
+            to = loadedBy->Load(canonical, options);
+        }
+        else
+        {
+            glGenTextures(1, &to);
+            LoadTextureFile(to, canonical, options.flipVertically, options.srgb);
+        }
+        // shared is not used past here, the insertion may move it
+        Entry &entry = entries[to];
+        entry.references = moved.references;
+        uint64_t contentHash = contentKey(file, options, streamedBy != nullptr);
+        entry.contentHash = byContent.count(contentHash) ? 0 : contentHash;
+        if (entry.contentHash != 0)
+            byContent[contentHash] = to;
+        entry.options = options;
+        entry.loadedBy = loadedBy;
+        entry.streamedBy = streamedBy;
+        entry.gpuBytes = estimateGpuBytes(file, canonical, options);
+        entry.paths.push_back(moved);
+        byPath[moved.key] = to;
+        gpuBytes += entry.gpuBytes;
+        return to;
+    }
+
+    static uint64_t contentKey(const MappedFile &file, const TextureOptions &options, bool streamed)
+    {
+        uint64_t hash = HashBytes(file.data, file.size);
+        // the options change the uploaded pixels, so they are part of the content key
+        hash ^= options.flipVertically ? 0x9e3779b97f4a7c15ull : 0;
+        hash ^= options.srgb ? 0xc2b2ae3d27d4eb4full : 0;
+        hash ^= streamed ? 0x165667b19e3779f9ull : 0;
+        return hash;
+    }
+
+    // size of the texture once uploaded. A baked texture is uploaded as its DDS payload; otherwise 8 bit channels,
+    // RGB is padded to RGBA by the drivers, plus a third for the mips.
+    static size_t estimateGpuBytes(const MappedFile &file, const std::string &path, const TextureOptions &options)
+    {
+        struct stat baked;
+        if (CompressedTexturesSupported() && !options.flipVertically && BakedTextureIsFresh(path, options.srgb) &&
+            stat(BakedTexturePath(path, options.srgb).c_str(), &baked) == 0 && (size_t)baked.st_size > sizeof(DdsHeader))
+            return baked.st_size - sizeof(DdsHeader);
+
+        int width, height, components;
+        if (!stbi_info_from_memory(file.data, (int)file.size, &width, &height, &components))
+            return 0;
+        size_t texelBytes = components == 3 ? 4 : components;
+        return (size_t)width * height * texelBytes * 4 / 3;
+    }
+};
+
+#endif
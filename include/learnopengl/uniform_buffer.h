@@ -0,0 +1,90 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <cstring>
+#include <string>
+
+// The uniform blocks shared by the programs in resources/shaders. The structs are laid out like the std140 blocks of
+// the same name in the shaders: every vec3 is followed by a float so that each pair fills one 16 byte row, and
+// nothing is padded by the compiler, which lets UniformBuffer compare them bytewise.
+const unsigned int CAMERA_UNIFORM_BINDING = 0;
+const unsigned int LIGHTS_UNIFORM_BINDING = 1;
+const unsigned int CLUSTERS_UNIFORM_BINDING = 2;
+
+// block Camera
+struct CameraUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float padding = 0.0f;
+};
+
+// block Lights, the lights themselves are in the buffer of the LightManager
+struct LightUniforms {
+    int pointLightCount;
+    int spotLightCount;
+    int padding[2] = {0, 0};
+};
+
+// block Clusters, the light grid of LightClusters
+struct ClusterUniforms {
+    int gridX, gridY, gridZ;
+    int enabled;
+    float tileScaleX, tileScaleY; // clusters per pixel
+    float sliceScale, sliceBias;  // slice = log(view depth) * sliceScale + sliceBias
+};
+
+static_assert(sizeof(CameraUniforms) == 144, "CameraUniforms does not match the std140 Camera block");
+static_assert(sizeof(LightUniforms) == 16, "LightUniforms does not match the std140 Lights block");
+static_assert(sizeof(ClusterUniforms) == 32, "ClusterUniforms does not match the std140 Clusters block");
+
+// A uniform buffer holding one block of type T for all programs. The block name is bound to binding in every program
+// linked from then on (see UniformBlockBindings), so create the buffers before the shaders that read them. Update
+// writes the whole block with one glBufferSubData, and only when it changed.
+template <typename T>
+class UniformBuffer
+{
+public:
+    unsigned int ID;
+
+    UniformBuffer(const std::string &block, unsigned int binding) : ID(0), written(false)
+    {
+        UniformBlockBindings()[block] = binding;
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &ID);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    // writes value into the buffer unless it holds it already. Once per frame, on the GL thread.
+    void Update(const T &value)
+    {
+        if (written && memcmp(&shadow, &value, sizeof(T)) == 0)
+            return;
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        shadow = value;
+        written = true;
+    }
+
+private:
+    T shadow;
+    bool written;
+};
+
+#endif
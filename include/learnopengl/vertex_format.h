@@ -0,0 +1,126 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Compact vertex encoding, 20 bytes against the 56 of a float Vertex:
+//  - position: 3 normalized int16 relative to the mesh bounds (w is stored as 1), decoded by VertexDecode::position,
+//  - normal: octahedral, 2 normalized int16,
+//  - texture coordinates: 2 normalized uint16 relative to the mesh's uv bounds, decoded by VertexDecode::texCoords,
+//  - tangent frame: a unit quaternion in 4 normalized int8, w is negative when the bitangent is mirrored.
+// The model shader decodes either format (see 2.model_lighting.vs), float meshes just get identity decoders.
+//
+// to rebuild the frame from the quaternion q in a shader:
+//   tangent   = vec3(1 - 2(y² + z²), 2(xy + wz), 2(xz - wy))
+//   normal    = vec3(2(xz + wy), 2(yz - wx), 1 - 2(x² + y²))
+//   bitangent = cross(normal, tangent) * sign(w)
+
+struct CompactVertex {
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoords[2];
+    int8_t tangentFrame[4];
+};
+
+// turn the stored values back into model space positions and texture coordinates
+struct VertexDecode {
+    glm::mat4 position = glm::mat4(1.0f);
+    glm::vec4 texCoords = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f); // uv = stored * xy + zw
+};
+
+inline int16_t PackSnorm16(float value)
+{
+    return (int16_t)std::lround(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+}
+
+inline uint16_t PackUnorm16(float value)
+{
+    return (uint16_t)std::lround(std::max(0.0f, std::min(1.0f, value)) * 65535.0f);
+}
+
+inline int8_t PackSnorm8(float value)
+{
+    return (int8_t)std::lround(std::max(-1.0f, std::min(1.0f, value)) * 127.0f);
+}
+
+// unit vector on the octahedron folded onto the [-1, 1] square
+inline glm::vec2 OctahedralEncode(const glm::vec3 &n)
+{
+    float length = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (length == 0.0f)
+        return glm::vec2(0.0f);
+    glm::vec2 p(n.x / length, n.y / length);
+    if (n.z < 0.0f)
+    {
+        glm::vec2 folded(1.0f - std::fabs(p.y), 1.0f - std::fabs(p.x));
+        p.x = p.x >= 0.0f ? folded.x : -folded.x;
+        p.y = p.y >= 0.0f ? folded.y : -folded.y;
+    }
+    return p;
+}
+
+inline glm::vec3 OctahedralDecode(const glm::vec2 &e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f)
+    {
+        float x = 1.0f - std::fabs(e.y), y = 1.0f - std::fabs(e.x);
+        n.x = e.x >= 0.0f ? x : -x;
+        n.y = e.y >= 0.0f ? y : -y;
+    }
+    return glm::normalize(n);
+}
+
+// rotation taking the x, y and z axes to tangent, bitangent and normal, as (x, y, z, w). The sign of w holds the
+// handedness, so w is kept away from 0 where 8 bits could no longer tell +0 from -0.
+inline glm::vec4 TangentFrameQuaternion(const glm::vec3 &normal, const glm::vec3 &tangent, const glm::vec3 &bitangent)
+{
+    glm::vec3 n = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+    // Gram-Schmidt, meshes without texture coordinates get any tangent
+    glm::vec3 t = tangent - n * glm::dot(n, tangent);
+    if (glm::length(t) < 1e-6f)
+        t = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) - n * n.x : glm::vec3(0.0f, 1.0f, 0.0f) - n * n.y;
+    t = glm::normalize(t);
+    glm::vec3 b = glm::cross(n, t);
+    bool mirrored = glm::dot(b, bitangent) < 0.0f;
+
+    // matrix to quaternion (Shepperd), columns t, b, n
+    float trace = t.x + b.y + n.z;
+    glm::vec4 q;
+    if (trace > 0.0f)
+    {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q = glm::vec4((b.z - n.y) / s, (n.x - t.z) / s, (t.y - b.x) / s, 0.25f * s);
+    }
+    else if (t.x > b.y && t.x > n.z)
+    {
+        float s = std::sqrt(1.0f + t.x - b.y - n.z) * 2.0f;
+        q = glm::vec4(0.25f * s, (b.x + t.y) / s, (n.x + t.z) / s, (b.z - n.y) / s);
+    }
+    else if (b.y > n.z)
+    {
+        float s = std::sqrt(1.0f + b.y - t.x - n.z) * 2.0f;
+        q = glm::vec4((b.x + t.y) / s, 0.25f * s, (n.y + b.z) / s, (n.x - t.z) / s);
+    }
+    else
+    {
+        float s = std::sqrt(1.0f + n.z - t.x - b.y) * 2.0f;
+        q = glm::vec4((n.x + t.z) / s, (n.y + b.z) / s, 0.25f * s, (t.y - b.x) / s);
+    }
+    q = glm::normalize(q);
+    if (q.w < 0.0f)
+        q = -q;
+    const float bias = 1.0f / 127.0f;
+    if (q.w < bias)
+    {
+        float scale = std::sqrt((1.0f - bias * bias) / std::max(1.0f - q.w * q.w, 1e-12f));
+        q = glm::vec4(q.x * scale, q.y * scale, q.z * scale, bias);
+    }
+    return mirrored ? -q : q;
+}
+
+#endif
@@ -5,10 +5,11 @@ layout (location = 1) out vec4 BrightColor;
 
 struct PointLight {
     vec3 position;
+    float radius;
 
-    vec3 specular;
-    vec3 diffuse;
     vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
 
     float constant;
     float linear;
@@ -17,6 +18,7 @@ struct PointLight {
 
 struct SpotLight {
     vec3 position;
+    float radius;
     vec3 direction;
     float cutOff;
     float outerCutOff;
@@ -41,13 +43,79 @@ in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-#define NUM_LIGHTS 3
+// CameraUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// LightUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Lights {
+    int pointLightCount;
+    int spotLightCount;
+};
+
+// the lights packed by the LightManager (include/learnopengl/light_manager.h), point lights first
+#define POINT_LIGHT_TEXELS 4
+#define SPOT_LIGHT_TEXELS 6
+uniform samplerBuffer lightData;
+
+// ClusterUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Clusters {
+    int clusterCountX;
+    int clusterCountY;
+    int clusterCountZ;
+    int clustersEnabled;
+    vec2 clusterTileScale;
+    float clusterSliceScale;
+    float clusterSliceBias;
+};
+
+// the lights of each cluster, see LightClusters (include/learnopengl/light_clusters.h)
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLights;
+
+// the lights reaching the object drawn, see LightAssignment (include/learnopengl/light_assignment.h)
+#define MAX_OBJECT_LIGHTS 4
+uniform bool objectLightsEnabled;
+uniform int objectPointLightCount;
+uniform int objectSpotLightCount;
+uniform int objectPointLights[MAX_OBJECT_LIGHTS];
+uniform int objectSpotLights[MAX_OBJECT_LIGHTS];
 
-uniform SpotLight spotLight[NUM_LIGHTS];
-uniform PointLight pointLight[NUM_LIGHTS];
 uniform Material material;
 
-uniform vec3 viewPosition;
+// the material at this fragment, sampled once up front: the lights are evaluated in branches that differ between
+// neighbouring fragments, where implicit derivatives are undefined
+vec3 albedo;
+vec4 specularSample;
+
+PointLight fetchPointLight(int index)
+{
+    int texel = index * POINT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 ambientConstant = texelFetch(lightData, texel + 1);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 2);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 3);
+    return PointLight(positionRadius.xyz, positionRadius.w, ambientConstant.xyz, diffuseLinear.xyz, specularQuadratic.xyz,
+                      ambientConstant.w, diffuseLinear.w, specularQuadratic.w);
+}
+
+SpotLight fetchSpotLight(int index)
+{
+    int texel = pointLightCount * POINT_LIGHT_TEXELS + index * SPOT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 directionCutOff = texelFetch(lightData, texel + 1);
+    vec4 ambientConstant = texelFetch(lightData, texel + 2);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 3);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 4);
+    float outerCutOff = texelFetch(lightData, texel + 5).x;
+    return SpotLight(positionRadius.xyz, positionRadius.w, directionCutOff.xyz, directionCutOff.w, outerCutOff,
+                     ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                     ambientConstant.xyz, diffuseLinear.xyz, specularQuadratic.xyz);
+}
+
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -62,9 +130,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularSample.xxx;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -86,24 +154,63 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
      float epsilon = light.cutOff - light.outerCutOff;
      float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
      // combine results
-     vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-     vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-     vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+     vec3 ambient = light.ambient * albedo;
+     vec3 diffuse = light.diffuse * diff * albedo;
+     vec3 specular = light.specular * spec * specularSample.rgb;
      ambient *= attenuation * intensity;
      diffuse *= attenuation * intensity;
      specular *= attenuation * intensity;
      return (ambient + diffuse + specular);
  }
 
+// lights are skipped past their influence radius, where they add next to nothing
+vec3 pointLightAt(int index, vec3 normal, vec3 viewDir)
+{
+    vec4 positionRadius = texelFetch(lightData, index * POINT_LIGHT_TEXELS);
+    if (distance(positionRadius.xyz, FragPos) >= positionRadius.w)
+        return vec3(0.0);
+    return CalcPointLight(fetchPointLight(index), normal, FragPos, viewDir);
+}
+
+vec3 spotLightAt(int index, vec3 normal, vec3 viewDir)
+{
+    vec4 positionRadius = texelFetch(lightData, pointLightCount * POINT_LIGHT_TEXELS + index * SPOT_LIGHT_TEXELS);
+    if (distance(positionRadius.xyz, FragPos) >= positionRadius.w)
+        return vec3(0.0);
+    return CalcSpotLight(fetchSpotLight(index), normal, FragPos, viewDir);
+}
+
 void main()
 {
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
     vec3 result = vec3(0,0,0);
-
-    for(int i = 0; i< NUM_LIGHTS; i++){
-        result += CalcPointLight(pointLight[i], normal, FragPos, viewDir);
-        result += CalcSpotLight(spotLight[i],normal,FragPos,viewDir);
+    albedo = texture(material.texture_diffuse1, TexCoords).rgb;
+    specularSample = texture(material.texture_specular1, TexCoords);
+
+    if (objectLightsEnabled) {
+        for(int i = 0; i < objectPointLightCount; i++)
+            result += pointLightAt(objectPointLights[i], normal, viewDir);
+        for(int i = 0; i < objectSpotLightCount; i++)
+            result += spotLightAt(objectSpotLights[i], normal, viewDir);
+    } else if (clustersEnabled != 0) {
+        // only the lights binned into the cluster of this fragment
+        float depth = -(view * vec4(FragPos, 1.0)).z;
+        ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy * clusterTileScale), int(floor(log(depth) * clusterSliceScale + clusterSliceBias)));
+        cluster = clamp(cluster, ivec3(0), ivec3(clusterCountX, clusterCountY, clusterCountZ) - 1);
+        uvec2 entry = texelFetch(clusterGrid, cluster.x + clusterCountX * (cluster.y + clusterCountY * cluster.z)).xy;
+        int offset = int(entry.x);
+        int points = int(entry.y & 0xffffu);
+        int spots = int(entry.y >> 16);
+        for(int i = 0; i < points; i++)
+            result += pointLightAt(int(texelFetch(clusterLights, offset + i).x), normal, viewDir);
+        for(int i = 0; i < spots; i++)
+            result += spotLightAt(int(texelFetch(clusterLights, offset + points + i).x), normal, viewDir);
+    } else {
+        for(int i = 0; i < pointLightCount; i++)
+            result += pointLightAt(i, normal, viewDir);
+        for(int i = 0; i < spotLightCount; i++)
+            result += spotLightAt(i, normal, viewDir);
     }
 
     FragColor = vec4(result, 1.0);
@@ -1,20 +1,37 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// float or compact vertices (include/learnopengl/vertex_format.h), the mesh sets the decode uniforms for either
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec3 aNormal; // octahedral in xy when compact
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
+// CameraUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 vertexPositionDecode;
+uniform vec4 vertexTexCoordDecode;
+uniform bool compactVertices;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = aNormal;
-    TexCoords = aTexCoords;    
+    FragPos = vec3(model * (vertexPositionDecode * aPos));
+    Normal = compactVertices ? octahedralDecode(aNormal.xy) : aNormal;
+    TexCoords = aTexCoords * vertexTexCoordDecode.xy + vertexTexCoordDecode.zw;
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -6,9 +6,14 @@ layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
+// CameraUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
@@ -0,0 +1,166 @@
+#version 330 core
+// one light over the G-buffer, added onto the light accumulation (include/learnopengl/deferred_renderer.h). Shades
+// like 2.model_lighting.fs.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+struct PointLight {
+    vec3 position;
+    float radius;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct SpotLight {
+    vec3 position;
+    float radius;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+
+// CameraUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// LightUniforms in include/learnopengl/uniform_buffer.h
+layout (std140) uniform Lights {
+    int pointLightCount;
+    int spotLightCount;
+};
+
+// the lights packed by the LightManager (include/learnopengl/light_manager.h), point lights first
+#define POINT_LIGHT_TEXELS 4
+#define SPOT_LIGHT_TEXELS 6
+uniform samplerBuffer lightData;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+// the light of this pass
+uniform int lightIndex;
+uniform bool spotLight;
+
+// the material at this pixel
+vec3 albedo;
+vec4 specularSample;
+float shininess;
+
+PointLight fetchPointLight(int index)
+{
+    int texel = index * POINT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 ambientConstant = texelFetch(lightData, texel + 1);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 2);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 3);
+    return PointLight(positionRadius.xyz, positionRadius.w, ambientConstant.xyz, diffuseLinear.xyz, specularQuadratic.xyz,
+                      ambientConstant.w, diffuseLinear.w, specularQuadratic.w);
+}
+
+SpotLight fetchSpotLight(int index)
+{
+    int texel = pointLightCount * POINT_LIGHT_TEXELS + index * SPOT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 directionCutOff = texelFetch(lightData, texel + 1);
+    vec4 ambientConstant = texelFetch(lightData, texel + 2);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 3);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 4);
+    float outerCutOff = texelFetch(lightData, texel + 5).x;
+    return SpotLight(positionRadius.xyz, positionRadius.w, directionCutOff.xyz, directionCutOff.w, outerCutOff,
+                     ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                     ambientConstant.xyz, diffuseLinear.xyz, specularQuadratic.xyz);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(viewDir, halfwayDir), 0.0), shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularSample.xxx;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+ {
+     vec3 lightDir = normalize(light.position - fragPos);
+     // diffuse shading
+     float diff = max(dot(normal, lightDir), 0.0);
+     // specular shading
+     vec3 halfwayDir = normalize(lightDir + viewDir);
+     float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+     // attenuation
+     float distance = length(light.position - fragPos);
+     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+     // spotlight intensity
+     float theta = dot(lightDir, normalize(-light.direction));
+     float epsilon = light.cutOff - light.outerCutOff;
+     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+     // combine results
+     vec3 ambient = light.ambient * albedo;
+     vec3 diffuse = light.diffuse * diff * albedo;
+     vec3 specular = light.specular * spec * specularSample.rgb;
+     ambient *= attenuation * intensity;
+     diffuse *= attenuation * intensity;
+     specular *= attenuation * intensity;
+     return (ambient + diffuse + specular);
+ }
+
+void main()
+{
+    float depth = texture(gDepth, TexCoords).r;
+    if (depth == 1.0)
+        discard;
+    vec4 position = inverseViewProjection * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+
+    // skipped past its influence radius, where it adds next to nothing
+    int texel = spotLight ? pointLightCount * POINT_LIGHT_TEXELS + lightIndex * SPOT_LIGHT_TEXELS : lightIndex * POINT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    if (distance(positionRadius.xyz, fragPos) >= positionRadius.w)
+        discard;
+
+    albedo = texture(gAlbedo, TexCoords).rgb;
+    specularSample = texture(gSpecular, TexCoords);
+    shininess = specularSample.a;
+    vec3 normal = texture(gNormal, TexCoords).xyz;
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    if (spotLight)
+        FragColor = vec4(CalcSpotLight(fetchSpotLight(lightIndex), normal, fragPos, viewDir), 1.0);
+    else
+        FragColor = vec4(CalcPointLight(fetchPointLight(lightIndex), normal, fragPos, viewDir), 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// the lit G-buffer into the scene color and its bright parts for the bloom, like 2.model_lighting.fs writes them
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D lightAccumulation;
+uniform sampler2D gAlbedo;
+
+void main()
+{
+    // the background keeps the clear color
+    if (texture(gAlbedo, TexCoords).a == 0.0)
+        discard;
+    FragColor = vec4(texture(lightAccumulation, TexCoords).rgb, 1.0);
+
+    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+
+    if(brightness > 1.0)
+        BrightColor = vec4(FragColor.rgb, 1.0);
+    else
+        BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// the surface seen at each pixel, lit afterwards by the deferred light passes (include/learnopengl/deferred_renderer.h)
+layout (location = 0) out vec4 gAlbedo;   // a is 1 where something was drawn
+layout (location = 1) out vec4 gSpecular; // rgb specular map, a shininess
+layout (location = 2) out vec4 gNormal;
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+
+    float shininess;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform Material material;
+
+void main()
+{
+    gAlbedo = vec4(texture(material.texture_diffuse1, TexCoords).rgb, 1.0);
+    gSpecular = vec4(texture(material.texture_specular1, TexCoords).rgb, material.shininess);
+    gNormal = vec4(normalize(Normal), 0.0);
+}
@@ -9,10 +9,23 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <learnopengl/asset_reloader.h>
 #include <learnopengl/filesystem.h>
+#include <learnopengl/deferred_renderer.h>
+#include <learnopengl/geometry_heap.h>
+#include <learnopengl/light_assignment.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/light_manager.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_reloader.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/memory_usage.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/uniform_buffer.h>
 
 #include <iostream>
 
@@ -26,10 +39,7 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-unsigned int loadCubemap(vector<std::string> faces);
-
 void renderQuad();
-unsigned int loadTexture(char const * path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -50,17 +60,6 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     bool ImGuiEnabled = false;
@@ -70,6 +69,9 @@ struct ProgramState {
     glm::vec3 backpackRotation = glm::vec3(0.0f);
     float backpackScale = 1.0f;
     PointLight pointLight;
+    bool objectLights = false;
+    bool clusteredLights = true;
+    bool deferredShading = false;
 
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
@@ -125,7 +127,9 @@ void ProgramState::LoadFromFile(std::string filename) {
 
 ProgramState *programState;
 
-void DrawImGui(ProgramState *programState);
+void DrawImGui(ProgramState *programState, const TextureLoader &textureLoader, const CullStats &cullStats,
+               const LightAssignment &lightAssignment, const LightClusters &lightClusters,
+               const DeferredRenderer &deferredRenderer);
 
 int main() {
     // glfw: initialize and configure
@@ -161,9 +165,35 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    LoadGLExtensions((GLADloadproc) glfwGetProcAddress);
+
+    // textures decode and models import on the thread pool, the GL objects are created on this thread.
+    // Flipping is chosen per texture request, none of our textures are flipped.
+    ThreadPool threadPool;
+    TextureLoader textureLoader(threadPool);
+    // model textures start as their mip tail and stream in as close as the camera gets, see RequestTextureDetail below
+    textureLoader.EnableStreaming(true);
+    ModelLoader modelLoader(threadPool, textureLoader);
 
-    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-    stbi_set_flip_vertically_on_load(true);
+    // load models
+    // -----------
+    // start the imports right away so they overlap with the shader and framebuffer setup below,
+    // the models are uploaded in modelLoader.Finish()
+    Model tobogan, cocoTree, bush, ocean, sand, swing, lamp;
+    // 20 byte quantized vertices instead of 56 byte float ones, 2.model_lighting.vs decodes both. Each model is one
+    // static batch, drawn with a call per material.
+    for (Model *model : {&tobogan, &cocoTree, &bush, &ocean, &sand, &swing, &lamp})
+    {
+        model->compactVertices = true;
+        model->staticBatch = true;
+    }
+    modelLoader.Load(tobogan, "resources/objects/pool/parque.obj");
+    modelLoader.Load(cocoTree, "resources/objects/coconutTree/coconutTreeBended.obj");
+    modelLoader.Load(bush, "resources/objects/bush/hedge.obj");
+    modelLoader.Load(ocean, "resources/objects/realPool/round-swimming-pool.obj");
+    modelLoader.Load(sand, "resources/objects/sand/sand.obj");
+    modelLoader.Load(swing, "resources/objects/swing/child_swing.obj");
+    modelLoader.Load(lamp, "resources/objects/lamp/candelabre.obj");
 
     programState = new ProgramState;
     programState->LoadFromFile("resources/program_state.txt");
@@ -245,12 +275,35 @@ int main() {
 
     //  BLOOM
 
+    // the Camera and Lights blocks, written once per frame and bound in every program that declares them
+    UniformBuffer<CameraUniforms> cameraBuffer("Camera", CAMERA_UNIFORM_BINDING);
+    LightManager lightManager;
+    lightManager.LoadFromFile("resources/lights.txt");
+    LightAssignment lightAssignment;
+    LightClusters lightClusters(threadPool);
+
     Shader lightCubeShader("resources/shaders/light_source.vs", "resources/shaders/light_source.fs");
     Shader blendingShader("resources/shaders/blending.vs", "resources/shaders/blending.fs");
     Shader blurShader("resources/shaders/7.blur.vs", "resources/shaders/7.blur.fs");
     Shader bloom_finalShader("resources/shaders/7.bloom_final.vs", "resources/shaders/7.bloom_final.fs");
     Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
     Shader skyboxShader("resources/shaders/skybox.vs","resources/shaders/skybox.fs");
+    Shader gBufferShader("resources/shaders/2.model_lighting.vs", "resources/shaders/gbuffer.fs");
+    Shader deferredLightShader("resources/shaders/deferred.vs", "resources/shaders/deferred_light.fs");
+    Shader deferredResolveShader("resources/shaders/deferred.vs", "resources/shaders/deferred_resolve.fs");
+    const ProgramCacheStats &programCache = ProgramCache::Stats();
+    std::cout << "PROGRAM_CACHE:: " << programCache.hits << " programs from the cache in " << programCache.loadMilliseconds
+              << " ms, saving about " << programCache.savedMilliseconds << " ms; " << programCache.misses << " built from source in "
+              << programCache.buildMilliseconds << " ms (" << programCache.rejected << " cached binaries rejected)" << std::endl;
+
+    // edits to the shader sources are compiled and swapped in while the program runs
+    ShaderReloader shaderReloader("resources/shaders");
+    for (Shader *shader : {&lightCubeShader, &blendingShader, &blurShader, &bloom_finalShader, &ourShader, &skyboxShader,
+                           &gBufferShader, &deferredLightShader, &deferredResolveShader})
+        shaderReloader.Watch(*shader);
+
+    // the models can be lit deferred instead, switched in the ImGui window
+    DeferredRenderer deferredRenderer(deferredLightShader, deferredResolveShader, SCR_WIDTH, SCR_HEIGHT);
 
     //----------------------------------
     // configure floating point framebuffer
@@ -272,12 +325,8 @@ int main() {
         // attach texture to framebuffer
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
     }
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    // attach the depth buffer, shared with the G-buffer of the deferred renderer
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, deferredRenderer.DepthTexture(), 0);
     // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
     unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
     glDrawBuffers(2, attachments);
@@ -341,12 +390,6 @@ int main() {
     glBindVertexArray(0);
 
 
-    glm::vec3 pointLightPositions[] = {
-            glm::vec3(-4.0f,1.2f,-1.6f),
-            glm::vec3(-1.0f,1.847f,-0.3f),
-            glm::vec3(-0.3f,1.847f,0.366f)
-    };
-
     //blendingShader.use();
     //blendingShader.setInt("texture1", 0);
 
@@ -411,8 +454,6 @@ int main() {
 
 
 
-    stbi_set_flip_vertically_on_load(false);
-
     vector<std::string> faces =
     {
                 "resources/objects/skybox/right.jpg",
@@ -422,7 +463,8 @@ int main() {
                 "resources/objects/skybox/front.jpg",
                 "resources/objects/skybox/back.jpg"
     };
-    unsigned int cubemapTexture = loadCubemap(faces);
+    // comes from resources/objects/skybox.cubemap in one mapped read once "make bake_textures" packed it
+    unsigned int cubemapTexture = textureLoader.LoadCubemap(faces);
 
 
 
@@ -439,31 +481,29 @@ int main() {
 
 
     // TEXTURE TO BLEND
-    unsigned int aquarium = loadTexture(FileSystem::getPath("resources/textures/tex.jpeg").c_str());
+    TextureOptions aquariumOptions;
+    aquariumOptions.srgb = true;
+    unsigned int aquarium = TextureRegistry::Instance().Acquire(FileSystem::getPath("resources/textures/tex.jpeg"), &textureLoader, aquariumOptions);
 
-    // load models
-    // -----------
-    Model tobogan("resources/objects/pool/parque.obj");
-    tobogan.SetShaderTextureNamePrefix("material.");
+    // wait for the models and upload their geometry as they complete, their textures keep streaming in
+    modelLoader.Finish();
+    MemoryUsage memory = ReadMemoryUsage();
+    std::cout << "MEMORY:: models loaded, resident " << memory.resident / (1024 * 1024) << " MB, peak "
+              << memory.peak / (1024 * 1024) << " MB" << std::endl;
 
-    Model cocoTree("resources/objects/coconutTree/coconutTreeBended.obj");
+    tobogan.SetShaderTextureNamePrefix("material.");
     cocoTree.SetShaderTextureNamePrefix("material.");
-
-    Model bush("resources/objects/bush/hedge.obj");
     bush.SetShaderTextureNamePrefix("material.");
-
-    Model ocean("resources/objects/realPool/round-swimming-pool.obj");
     ocean.SetShaderTextureNamePrefix("material.");
-
-    Model sand("resources/objects/sand/sand.obj");
     sand.SetShaderTextureNamePrefix("material.");
-
-    Model swing("resources/objects/swing/child_swing.obj");
     swing.SetShaderTextureNamePrefix("material.");
-
-    Model lamp("resources/objects/lamp/candelabre.obj");
     lamp.SetShaderTextureNamePrefix("material.");
 
+    // edits to the models and their textures show up while the program runs
+    AssetReloader assetReloader(threadPool, textureLoader, "resources/objects");
+    for (Model *model : {&tobogan, &cocoTree, &bush, &ocean, &sand, &swing, &lamp})
+        assetReloader.Watch(*model);
+
 
 
     PointLight& pointLight = programState->pointLight;
@@ -473,12 +513,6 @@ int main() {
     pointLight.diffuse = glm::vec3(0.95f, 1 ,1);
     pointLight.specular = glm::vec3(1.0, 1.0, 1.0);
 
-    float pointLight_constant = 3.0f;
-    float pointLight_linear = 24.0f;
-    float pointLight_quadratic = 32.08;
-
-    glm::vec3 ambient(0,0,0);
-
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -487,10 +521,21 @@ int main() {
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
+    ourShader.use();
+    ourShader.setInt("lightData", LIGHT_DATA_TEXTURE_UNIT);
+    ourShader.setInt("clusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+    ourShader.setInt("clusterLights", CLUSTER_LIGHTS_TEXTURE_UNIT);
 
 
     //glEnable(GL_CULL_FACE);
 
+    CullStats cullStats;
+    // set for every model drawn, resolved once instead of by name
+    UniformHandle<glm::mat4> forwardModelUniform = ourShader.Uniform<glm::mat4>("model");
+    UniformHandle<float> forwardShininessUniform = ourShader.Uniform<float>("material.shininess");
+    UniformHandle<glm::mat4> gBufferModelUniform = gBufferShader.Uniform<glm::mat4>("model");
+    UniformHandle<float> gBufferShininessUniform = gBufferShader.Uniform<float>("material.shininess");
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
@@ -504,6 +549,11 @@ int main() {
         // -----
         processInput(window);
 
+        // swap in the assets that changed on disk, then upload textures that finished decoding, spending at most
+        // ~2ms of the frame on them
+        assetReloader.Update();
+        shaderReloader.Update();
+        textureLoader.Update(2.0);
 
 
         // render
@@ -517,86 +567,39 @@ int main() {
         glEnable(GL_CULL_FACE);
 
 
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-
-        // FIRST LIGHT SOURCE -------------------------------------------------------
-        pointLight.position = glm::vec3(glm::vec3(-4.0f,2.5f,0.3f));
-        //pointLight.position = glm::vec3(4.0 * cos(currentFrame), 4.0f, 4.0 * sin(currentFrame));
-        ourShader.setVec3("pointLight[0].position",pointLightPositions[0]);
-        ourShader.setVec3("pointLight[0].ambient", glm::vec3(0.2f,0.2f,0.2f));
-        ourShader.setVec3("pointLight[0].diffuse", glm::vec3(0.0f,1.0f,1.0f));
-        ourShader.setVec3("pointLight[0].specular", glm::vec3(0.0f,2.0f,2.0f));
-        ourShader.setFloat("pointLight[0].constant", pointLight_constant);
-        ourShader.setFloat("pointLight[0].linear", pointLight_linear);
-        ourShader.setFloat("pointLight[0].quadratic", pointLight_quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        ourShader.setVec3("spotLight[0].position", pointLightPositions[0]);
-        ourShader.setVec3("spotLight[0].direction", 0.0f, -1.0f, 0.0f);
-        ourShader.setVec3("spotLight[0].ambient", 0.0f, 0.0f, 0.0f);
-        ourShader.setVec3("spotLight[0].diffuse", 0.0f, 1.0f, 1.0f);
-        ourShader.setVec3("spotLight[0].specular", 0.0f, 3.0f, 3.0f);
-        ourShader.setFloat("spotLight[0].constant", pointLight_constant);
-        ourShader.setFloat("spotLight[0].linear", pointLight_linear);
-        ourShader.setFloat("spotLight[0].quadratic", pointLight_quadratic);
-        ourShader.setFloat("spotLight[0].cutOff", glm::cos(glm::radians(1.0f)));
-        ourShader.setFloat("spotLight[0].outerCutOff", glm::cos(glm::radians(20.0f)));
-
-
-        //SECOND LIGHT SOURCE -------------------------
-
-        ourShader.setVec3("pointLight[1].position", pointLightPositions[1]);
-        ourShader.setVec3("pointLight[1].ambient", ambient);
-        ourShader.setVec3("pointLight[1].diffuse", 1,1,1);
-        ourShader.setVec3("pointLight[1].specular", 1,1,1);
-        ourShader.setFloat("pointLight[1].constant", pointLight_constant);
-        ourShader.setFloat("pointLight[1].linear", pointLight_linear);
-        ourShader.setFloat("pointLight[1].quadratic", pointLight_quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        ourShader.setVec3("spotLight[1].position", pointLightPositions[1]);
-        ourShader.setVec3("spotLight[1].direction", 0.0f, -1.0f, 0.0f);
-        ourShader.setVec3("spotLight[1].ambient", 0.0f, 0.0f, 0.0f);
-        ourShader.setVec3("spotLight[1].diffuse", 1.0f, 1.0f, 1.0f);
-        ourShader.setVec3("spotLight[1].specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("spotLight[1].constant", 1.0f);
-        ourShader.setFloat("spotLight[1].linear", 3.4);
-        ourShader.setFloat("spotLight[1].quadratic", 0.932);
-        ourShader.setFloat("spotLight[1].cutOff", glm::cos(glm::radians(1.0f)));
-        ourShader.setFloat("spotLight[1].outerCutOff", glm::cos(glm::radians(24.0f)));
-
-        //THIRD LIGHT SOURCE------------------------------------------
-        ourShader.setVec3("pointLight[2].position", pointLightPositions[2]);
-        ourShader.setVec3("pointLight[2].ambient", ambient);
-        ourShader.setVec3("pointLight[2].diffuse", 2,0,2);
-        ourShader.setVec3("pointLight[2].specular", 2,0,2);
-        ourShader.setFloat("pointLight[2].constant", pointLight_constant);
-        ourShader.setFloat("pointLight[2].linear", pointLight_linear);
-        ourShader.setFloat("pointLight[2].quadratic", pointLight_quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        ourShader.setVec3("spotLight[2].position", pointLightPositions[2]);
-        ourShader.setVec3("spotLight[2].direction", 0.0f, -1.0f, 0.0f);
-        ourShader.setVec3("spotLight[2].ambient", 0.0f, 0.0f, 0.0f);
-        ourShader.setVec3("spotLight[2].diffuse", 1.0f, 0.0f, 1.0f);
-        ourShader.setVec3("spotLight[2].specular", 1.0f, 0.0f, 1.0f);
-        ourShader.setFloat("spotLight[2].constant", 1.0f);
-        ourShader.setFloat("spotLight[2].linear", 3.4);
-        ourShader.setFloat("spotLight[2].quadratic", 0.932);
-        ourShader.setFloat("spotLight[2].cutOff", glm::cos(glm::radians(2.0f)));
-        ourShader.setFloat("spotLight[2].outerCutOff", glm::cos(glm::radians(24.0f)));
-
-
-        // view/projection transformations
+        // view/projection transformations, shared by all the programs through the Camera block
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
                                                 (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
+        CameraUniforms camera;
+        camera.projection = projection;
+        camera.view = view;
+        camera.viewPosition = programState->camera.Position;
+        cameraBuffer.Update(camera);
+
+        // the lights of resources/lights.txt
+        lightManager.Upload();
+        // and binned into the clusters of the view, so each fragment only goes through the lights around it
+        lightClusters.Update(lightManager, projection, view, SCR_WIDTH, SCR_HEIGHT,
+                             programState->clusteredLights && !programState->deferredShading);
+
+        // the models are lit as they are drawn, or drawn into the G-buffer and lit afterwards
+        bool deferred = programState->deferredShading;
+        Shader &sceneShader = deferred ? gBufferShader : ourShader;
+        UniformHandle<glm::mat4> modelUniform = deferred ? gBufferModelUniform : forwardModelUniform;
+        UniformHandle<float> shininessUniform = deferred ? gBufferShininessUniform : forwardShininessUniform;
+        if (deferred)
+            deferredRenderer.BeginGeometry();
+        // or, forward, each model only goes through the few lights reaching it
+        lightAssignment.Update(lightManager, programState->objectLights && !deferred);
+
+        // don't forget to enable shader before setting uniforms
+        sceneShader.use();
+        sceneShader.Set(shininessUniform, 32.0f);
+
+        // the models skip what is off screen or facing away (back faces are culled here), counted for the ImGui window
+        cullStats = CullStats();
+        float pixelsPerUnit = programState->camera.PixelsPerUnit(SCR_HEIGHT);
 
 
 
@@ -608,61 +611,77 @@ int main() {
         model = glm::translate(model, glm::vec3(0.0f,-24.0f,0.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(15.0f)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        ourShader.setFloat("material.shininess", 1.0f);
-        sand.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        sceneShader.Set(shininessUniform, 1.0f);
+        lightAssignment.Assign(sceneShader, sand, model);
+        sand.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        sand.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
-        ourShader.setFloat("material.shininess", 32.0f);
+        sceneShader.Set(shininessUniform, 32.0f);
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-4.0f,-1.2f,-2.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.0035f)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        lamp.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, lamp, model);
+        lamp.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        lamp.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-3.0f,-0.3f,-1.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         //model = glm::rotate(model, glm::radians(currentFrame), glm::vec3(0,0,1));
         model = glm::scale(model, glm::vec3(0.1f)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        swing.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, swing, model);
+        swing.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        swing.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-1.4f,0,-2.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.009)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        ocean.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, ocean, model);
+        ocean.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        ocean.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-0.4f,0,2.2f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.005)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        bush.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, bush, model);
+        bush.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        bush.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.5f,0,-2.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.005)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        bush.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, bush, model);
+        bush.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats, 1);
+        bush.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.5f,0,-2.0f)
                 /*programState->backpackPosition*/); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.005)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        cocoTree.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, cocoTree, model);
+        cocoTree.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        cocoTree.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, /*glm::vec3(-0.4f,0,2.2f)*/
                                programState->backpackPosition); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.005)/*glm::vec3(programState->backpackScale)*/);    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        cocoTree.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, cocoTree, model);
+        cocoTree.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats, 1);
+        cocoTree.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
 
         model = glm::mat4(1.0f);
@@ -670,80 +689,34 @@ int main() {
                                glm::vec3(0,0,-0.6)); // translate it down so it's at the center of the scene
         model = glm::rotate(model, glm::radians(45.0f), glm::vec3(0,1,0));
         model = glm::scale(model, glm::vec3(0.01));    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        tobogan.Draw(ourShader);
+        sceneShader.Set(modelUniform, model);
+        lightAssignment.Assign(sceneShader, tobogan, model);
+        tobogan.Draw(sceneShader, MakeCullView(projection, view, model, pixelsPerUnit), cullStats);
+        tobogan.RequestTextureDetail(textureLoader, model, programState->camera, SCR_HEIGHT);
 
-        //FIRST LIGHT-----------------------------------
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        glBindVertexArray(cubeVAO);
+        if (deferred)
+            deferredRenderer.Light(lightManager, projection, view, hdrFBO);
 
         // we now draw as many light bulbs as we have point lights.
-        model = glm::mat4(1.0f);
-
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointLightPositions[0]/*programState->backpackPosition*/);
-        model = glm::scale(model, glm::vec3(0.1f)); // Make it a smaller cube
-        lightCubeShader.setVec3("lightColor", glm::vec3(0.0f,5.0f,5.0f));
-        lightCubeShader.setMat4("model", model);
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        //glDisable(GL_CULL_FACE);
-        glBindVertexArray(0);
-
-        //SECOND LIGHT-----------------------------
         lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
         glBindVertexArray(cubeVAO);
+        for (const PointLight &light : lightManager.pointLights)
+        {
+            model = glm::mat4(1.0f);
+            model = glm::translate(model, light.position);
+            model = glm::scale(model, glm::vec3(0.1f)); // Make it a smaller cube
+            lightCubeShader.setVec3("lightColor", light.cubeColor);
+            lightCubeShader.setMat4("model", model);
 
-        // we now draw as many light bulbs as we have point lights.
-        //model = glm::mat4(1.0f);
-
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointLightPositions[1]/*programState->backpackPosition*/);
-        model = glm::scale(model, glm::vec3(0.1f)); // Make it a smaller cube
-        lightCubeShader.setVec3("lightColor", glm::vec3(1.0f,1.0f,1.0f));
-        lightCubeShader.setMat4("model", model);
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        //glDisable(GL_CULL_FACE);
-        glBindVertexArray(0);
-        //THIRD LIGHT-------------------------------
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        glBindVertexArray(cubeVAO);
-
-        // we now draw as many light bulbs as we have point lights.
-        //model = glm::mat4(1.0f);
-
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointLightPositions[2] /*programState->backpackPosition*/);
-        model = glm::scale(model, glm::vec3(0.1f)); // Make it a smaller cube
-        lightCubeShader.setVec3("lightColor", glm::vec3(5.0f,0.0f,5.0f));
-        lightCubeShader.setMat4("model", model);
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        //glDisable(GL_CULL_FACE);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
         glBindVertexArray(0);
 
 
         //SKYBOX1
         glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+        // skybox.vs drops the translation of the view itself
         skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        /*projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);*/
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
         // skybox cube
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
@@ -757,11 +730,8 @@ int main() {
         glDisable(GL_CULL_FACE);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, aquarium);
-         view = programState->camera.GetViewMatrix();
         blendingShader.use();
         blendingShader.setInt("texture1", 0);
-        blendingShader.setMat4("projection", projection);
-        blendingShader.setMat4("view", view);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, /*programState->backpackPosition*/glm::vec3(0,0,0));
@@ -814,7 +784,7 @@ int main() {
 
 
         if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+            DrawImGui(programState, textureLoader, cullStats, lightAssignment, lightClusters, deferredRenderer);
 
 
 
@@ -884,7 +854,9 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     programState->camera.ProcessMouseScroll(yoffset);
 }
 
-void DrawImGui(ProgramState *programState) {
+void DrawImGui(ProgramState *programState, const TextureLoader &textureLoader, const CullStats &cullStats,
+               const LightAssignment &lightAssignment, const LightClusters &lightClusters,
+               const DeferredRenderer &deferredRenderer) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -903,6 +875,46 @@ void DrawImGui(ProgramState *programState) {
         ImGui::DragFloat("pointLight.constant", &programState->pointLight.constant, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.linear", &programState->pointLight.linear, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.quadratic", &programState->pointLight.quadratic, 0.05, 0.0, 1.0);
+
+        const TextureRegistry &textures = TextureRegistry::Instance();
+        ImGui::Text("Textures: %u (%.1f MB)", textures.Count(), textures.GpuBytes() / (1024.0 * 1024.0));
+        ImGui::Text("Streamed mips resident: %.1f MB", textureLoader.StreamedBytes() / (1024.0 * 1024.0));
+        ImGui::Text("Triangles: %u, culled %u by frustum, %u back facing", cullStats.triangles,
+                    cullStats.trianglesCulledFrustum, cullStats.trianglesCulledBackface);
+        ImGui::Text("Meshlets: %u, culled %u", cullStats.meshlets, cullStats.meshletsCulled);
+        ImGui::Text("Triangles left out by LOD: %u", cullStats.trianglesSkippedLod);
+        ImGui::Text("Model draw calls: %u", cullStats.drawCalls);
+        ImGui::Text("Frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+        ImGui::Checkbox("Deferred shading", &programState->deferredShading);
+        if (programState->deferredShading)
+        {
+            const DeferredStats &deferred = deferredRenderer.Stats();
+            ImGui::Text("Light passes: %u, %.1f Mpixels scissored", deferred.lights, deferred.pixels / 1e6);
+        }
+        ImGui::Checkbox("Lights per object", &programState->objectLights);
+        if (programState->objectLights && !programState->deferredShading)
+        {
+            const LightAssignmentStats &assignment = lightAssignment.Stats();
+            ImGui::Text("Lights per draw: %.1f, %u dropped over the limit of %d", assignment.draws ? (float)assignment.lights / assignment.draws : 0.0f,
+                        assignment.dropped, MAX_OBJECT_LIGHTS);
+        }
+        ImGui::Checkbox("Clustered lights", &programState->clusteredLights);
+        const LightClusterStats &clusters = lightClusters.Stats();
+        ImGui::Text("Light clusters: %u lit, %u lights at most, %u references, %.2f ms", clusters.clustersLit,
+                    clusters.maxPerCluster, clusters.indices, clusters.milliseconds);
+        GeometryHeap &geometry = GeometryHeap::Instance();
+        ImGui::Text("Geometry: %.1f of %.1f MB", geometry.UsedBytes() / (1024.0 * 1024.0), geometry.CapacityBytes() / (1024.0 * 1024.0));
+        if (ImGui::Button("Defragment geometry"))
+            geometry.Defragment();
+        // read from /proc about once a second, not every frame
+        static MemoryUsage memory;
+        static double memoryReadAt = -1.0;
+        if (memoryReadAt < 0.0 || glfwGetTime() - memoryReadAt >= 1.0)
+        {
+            memory = ReadMemoryUsage();
+            memoryReadAt = glfwGetTime();
+        }
+        ImGui::Text("Memory: %.1f MB resident, %.1f MB peak", memory.resident / (1024.0 * 1024.0), memory.peak / (1024.0 * 1024.0));
         ImGui::End();
     }
 
@@ -932,39 +944,6 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     }
 }
 
-unsigned int loadCubemap(vector<std::string> faces)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
-
-
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
 
@@ -995,41 +974,4 @@ void renderQuad()
     glBindVertexArray(0);
 }
 
-unsigned int loadTexture(char const * path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
-
 
@@ -0,0 +1,118 @@
+// Benchmarks the image kernels of include/learnopengl/image_kernels.h: every kernel set the CPU supports against
+// the scalar one, and building a full mip chain on the CPU against glGenerateMipmap on the current driver
+// (run it with LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe). Usage: image_kernels_bench [image] [iterations]
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/texture_loader.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+template <typename Function>
+static double milliseconds(int iterations, Function function)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        function();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static void report(const char *kernel, const char *name, double ms, double scalarMs)
+{
+    std::cout << "  " << kernel << " " << name << ": " << ms << " ms (" << scalarMs / ms << "x scalar)" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : FileSystem::getPath("resources/textures/container.jpg");
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    int width, height, components;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 3);
+    if (!data)
+    {
+        std::cout << "Failed to load " << path << std::endl;
+        return 1;
+    }
+    size_t pixelCount = (size_t)width * height;
+    std::vector<unsigned char> rgb(data, data + pixelCount * 3);
+    stbi_image_free(data);
+    std::vector<unsigned char> rgba(pixelCount * 4), mip((size_t)MipDimension(width) * MipDimension(height) * 4);
+    ScalarImageKernels().expandRGBToRGBA(rgb.data(), rgba.data(), pixelCount);
+    std::cout << path << ": " << width << "x" << height << ", " << iterations << " iterations" << std::endl;
+
+    // kernels
+    const ImageKernels &scalar = ScalarImageKernels();
+    double scalarExpand = milliseconds(iterations, [&]() { scalar.expandRGBToRGBA(rgb.data(), rgba.data(), pixelCount); });
+    double scalarFlip = milliseconds(iterations, [&]() { scalar.flipRows(rgba.data(), (size_t)width * 4, height); });
+    double scalarDownsample = milliseconds(iterations, [&]() { scalar.downsampleRGBA8(rgba.data(), width, height, mip.data()); });
+    for (const ImageKernels *kernels : SupportedImageKernels())
+    {
+        report(kernels->name, "rgb to rgba", milliseconds(iterations, [&]() {
+            kernels->expandRGBToRGBA(rgb.data(), rgba.data(), pixelCount);
+        }), scalarExpand);
+        report(kernels->name, "flip", milliseconds(iterations, [&]() {
+            kernels->flipRows(rgba.data(), (size_t)width * 4, height);
+        }), scalarFlip);
+        report(kernels->name, "downsample", milliseconds(iterations, [&]() {
+            kernels->downsampleRGBA8(rgba.data(), width, height, mip.data());
+        }), scalarDownsample);
+    }
+    report("scalar", "downsample srgb", milliseconds(iterations, [&]() {
+        DownsampleSRGB(rgba.data(), width, height, 4, mip.data());
+    }), scalarDownsample);
+
+    // whole chain on the CPU, as the texture loader builds it on a worker
+    double cpuChain = milliseconds(iterations, [&]() { DecodedImage image = DecodeImage(path, false, true); });
+    double decodeOnly = milliseconds(iterations, [&]() { DecodedImage image = DecodeImage(path, false, false); });
+    std::cout << "decode: " << decodeOnly << " ms, decode + mip chain: " << cpuChain << " ms" << std::endl;
+
+    // the driver side: uploading level 0 and glGenerateMipmap against uploading the prebuilt chain
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "image_kernels_bench", NULL, NULL);
+    if (!window)
+    {
+        std::cout << "No GL context, skipping the glGenerateMipmap comparison" << std::endl;
+        glfwTerminate();
+        return 0;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+    std::cout << "GL renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    DecodedImage chain = DecodeImage(path, false, true);
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    double generate = milliseconds(iterations, [&]() {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+    });
+    double prebuilt = milliseconds(iterations, [&]() {
+        for (unsigned int i = 0; i < chain.levels.size(); i++)
+            UploadLevel(GL_TEXTURE_2D, i, GL_RGBA, chain);
+        glFinish();
+    });
+    std::cout << "GL thread, upload + glGenerateMipmap: " << generate << " ms" << std::endl;
+    std::cout << "GL thread, upload of the CPU built chain: " << prebuilt << " ms" << std::endl;
+
+    glDeleteTextures(1, &texture);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Bakes every JPEG/PNG texture under the given directories (resources/objects and resources/textures by default)
+// into a block compressed DDS with its full mip chain, see include/learnopengl/texture_baker.h, and packs every
+// directory of six cubemap faces into a single file, see include/learnopengl/cubemap_pack.h.
+// Color maps get sRGB correct mips like the runtime builds them (TextureOptions::srgb): the material libraries found
+// next to the textures tell them apart, a map_Kd is a color map and every other map holds data. Images no material
+// uses are taken for color images, an image used both ways is baked both ways.
+// Outputs already newer than their sources are skipped unless --force is given.
+
+#include <learnopengl/cubemap_pack.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/texture_baker.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool isTextureSource(const std::string &name)
+{
+    std::string::size_type dot = name.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = name.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "jpg" || extension == "jpeg" || extension == "png";
+}
+
+// the faces of a cubemap stored in directory, if it holds all six with one extension
+static bool findCubemapFaces(const std::string &directory, std::vector<std::string> &faces)
+{
+    const char *extensions[] = {".jpg", ".jpeg", ".png"};
+    for (const char *extension : extensions)
+    {
+        faces.clear();
+        for (const char *name : CUBEMAP_FACE_NAMES)
+        {
+            struct stat info;
+            std::string path = directory + '/' + name + extension;
+            if (stat(path.c_str(), &info) == 0)
+                faces.push_back(path);
+        }
+        if (faces.size() == 6)
+            return true;
+    }
+    return false;
+}
+
+static bool isMaterialLibrary(const std::string &name)
+{
+    return name.size() > 4 && name.compare(name.size() - 4, 4, ".mtl") == 0;
+}
+
+static std::string canonicalPath(const std::string &path)
+{
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved))
+        return std::string(resolved);
+    return path;
+}
+
+// the textures a material library references, split into color maps and data maps (canonical paths)
+static void readMaterialLibrary(const std::string &path, std::set<std::string> &colorMaps, std::set<std::string> &dataMaps)
+{
+    std::ifstream file(path);
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line);
+        std::string statement, word, texture;
+        words >> statement;
+        if (statement.compare(0, 4, "map_") != 0 && statement != "bump" && statement != "disp" && statement != "decal" && statement != "norm")
+            continue;
+        // the file name comes after the options
+        while (words >> word)
+            texture = word;
+        if (texture.empty())
+            continue;
+        std::replace(texture.begin(), texture.end(), '\\', '/');
+        (statement == "map_Kd" ? colorMaps : dataMaps).insert(canonicalPath(directory + '/' + texture));
+    }
+}
+
+static void collectTextures(const std::string &directory, std::vector<std::string> &sources, std::vector<std::vector<std::string>> &cubemaps,
+                            std::set<std::string> &colorMaps, std::set<std::string> &dataMaps)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    std::vector<std::string> faces;
+    if (findCubemapFaces(directory, faces))
+        cubemaps.push_back(faces);
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        std::string path = directory + '/' + entry->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            collectTextures(path, sources, cubemaps, colorMaps, dataMaps);
+        else if (isTextureSource(entry->d_name))
+            sources.push_back(path);
+        else if (isMaterialLibrary(entry->d_name))
+            readMaterialLibrary(path, colorMaps, dataMaps);
+    }
+    closedir(dir);
+}
+
+int main(int argc, char **argv)
+{
+    bool force = false;
+    std::vector<std::string> directories;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--force") == 0)
+            force = true;
+        else
+            directories.push_back(argv[i]);
+    }
+    if (directories.empty())
+    {
+        directories.push_back(FileSystem::getPath("resources/objects"));
+        directories.push_back(FileSystem::getPath("resources/textures"));
+    }
+
+    std::vector<std::string> sources;
+    std::vector<std::vector<std::string>> cubemaps;
+    std::set<std::string> colorMaps, dataMaps;
+    for (const std::string &directory : directories)
+        collectTextures(directory, sources, cubemaps, colorMaps, dataMaps);
+    std::sort(sources.begin(), sources.end());
+
+    unsigned int baked = 0, skipped = 0, failed = 0;
+    for (const std::string &source : sources)
+    {
+        std::string canonical = canonicalPath(source);
+        bool data = dataMaps.count(canonical) > 0;
+        bool color = colorMaps.count(canonical) > 0 || !data;
+        for (bool srgb : {true, false})
+        {
+            if (srgb ? !color : !data)
+                continue;
+            if (!force && BakedTextureIsFresh(source, srgb))
+            {
+                skipped++;
+                continue;
+            }
+            if (BakeTexture(source, srgb))
+            {
+                baked++;
+                std::cout << "baked " << BakedTexturePath(source, srgb) << std::endl;
+            }
+            else
+            {
+                // grayscale and unreadable images keep loading from their source at runtime
+                failed++;
+                std::cout << "not baked " << source << std::endl;
+            }
+        }
+    }
+    std::cout << baked << " baked, " << skipped << " up to date, " << failed << " not baked" << std::endl;
+
+    unsigned int packed = 0;
+    for (const std::vector<std::string> &faces : cubemaps)
+    {
+        if (!force && CubemapPackIsFresh(faces))
+            continue;
+        if (PackCubemap(faces))
+        {
+            packed++;
+            std::cout << "packed " << CubemapPackPath(faces) << std::endl;
+        }
+        else
+        {
+            std::cout << "not packed " << CubemapPackPath(faces) << " (faces must be square and of one size)" << std::endl;
+        }
+    }
+    std::cout << packed << " cubemaps packed" << std::endl;
+    return 0;
+}